@@ -0,0 +1,257 @@
+"""
+Animation Processing for Laser Projector
+Turns a GIF, animated WebP/PNG or video into a timeline of laser frames
+whose strokes keep their order and start point from one frame to the next
+"""
+
+import os
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Any, Callable, List, Optional, Tuple
+
+import cv2
+import numpy as np
+
+from cpp_generator import MAX_PATTERNS, Pattern, generate_animation_cpp
+from processor import (
+    ProcessingConfig, ProcessingResult, failure_result, path_angles, path_result, prepare_gray,
+    skeleton_path, skeletonize, split_strokes
+)
+from stage_cache import StageCache
+
+ANIMATED_IMAGE_EXTENSIONS = {".gif", ".webp", ".png", ".apng"}
+DEFAULT_FRAME_MS = 100  # for videos that report no frame rate
+THUMBNAIL_SIZE = 64
+
+
+@dataclass
+class AnimationResult:
+    """Result of animation processing"""
+    frames: List[ProcessingResult]  # distinct frames, in order of first appearance
+    sequence: List[int]  # frame index for every source frame
+    durations_ms: List[int]  # display time of every source frame
+    success: bool
+    message: str
+    skipped: List[int] = field(default_factory=list)  # distinct frames with nothing to draw
+
+
+def _image_frames(path: str, max_frames: int) -> Optional[Tuple[List[np.ndarray], List[int]]]:
+    """Frames and durations of an animated image, None if it is not one"""
+    if hasattr(cv2, "imreadanimation"):
+        loaded, animation = cv2.imreadanimation(path, 0, max_frames)
+        if loaded and animation.frames:
+            return list(animation.frames), [int(d) or DEFAULT_FRAME_MS for d in animation.durations]
+    try:
+        from PIL import Image, ImageSequence
+    except ImportError:
+        return None
+    try:
+        with Image.open(path) as image:
+            frames, durations = [], []
+            for frame in ImageSequence.Iterator(image):
+                if len(frames) >= max_frames:
+                    break
+                rgba = np.asarray(frame.convert("RGBA"))
+                frames.append(cv2.cvtColor(rgba, cv2.COLOR_RGBA2BGRA))
+                durations.append(int(frame.info.get("duration") or DEFAULT_FRAME_MS))
+            return frames, durations
+    except OSError:
+        return None
+
+
+def _video_frames(path: str, max_frames: int) -> Tuple[List[np.ndarray], List[int]]:
+    """Frames of a video, each shown for one frame period"""
+    capture = cv2.VideoCapture(path)
+    if not capture.isOpened():
+        raise FileNotFoundError(f"Could not open animation: {path}")
+    fps = capture.get(cv2.CAP_PROP_FPS)
+    frame_ms = round(1000 / fps) if fps > 0 else DEFAULT_FRAME_MS
+    frames = []
+    try:
+        while len(frames) < max_frames:
+            ok, frame = capture.read()
+            if not ok:
+                break
+            frames.append(frame)
+    finally:
+        capture.release()
+    return frames, [frame_ms] * len(frames)
+
+
+def load_frames(path: str, max_frames: int = MAX_PATTERNS) -> Tuple[List[np.ndarray], List[int]]:
+    """
+    Up to max_frames frames (BGR or BGRA) of an animated image or a video,
+    with how long each is shown in milliseconds
+    """
+    if not os.path.isfile(path):
+        raise FileNotFoundError(f"Could not open animation: {path}")
+    loaded = None
+    if Path(path).suffix.lower() in ANIMATED_IMAGE_EXTENSIONS:
+        loaded = _image_frames(path, max_frames)
+    frames, durations = loaded if loaded else _video_frames(path, max_frames)
+    if not frames:
+        raise FileNotFoundError(f"No frames in animation: {path}")
+    return frames, durations
+
+
+def _thumbnail(gray: np.ndarray) -> np.ndarray:
+    return cv2.resize(gray, (THUMBNAIL_SIZE, THUMBNAIL_SIZE), interpolation=cv2.INTER_AREA).astype(np.float32)
+
+
+def dedupe_frames(grays: List[np.ndarray], threshold: float = 2.0) -> Tuple[List[int], List[int]]:
+    """
+    Frames that look alike are drawn once: a frame whose thumbnail differs
+    from an earlier distinct one by at most threshold gray levels on average
+    reuses it. Returns the distinct frames' indices and, for every frame,
+    which distinct frame it shows.
+    """
+    distinct: List[int] = []
+    thumbnails: List[np.ndarray] = []
+    sequence: List[int] = []
+    for index, gray in enumerate(grays):
+        thumbnail = _thumbnail(gray)
+        differences = [float(cv2.norm(thumbnail, other, cv2.NORM_L1)) / thumbnail.size for other in thumbnails]
+        if differences and min(differences) <= threshold:
+            sequence.append(int(np.argmin(differences)))
+            continue
+        sequence.append(len(distinct))
+        distinct.append(index)
+        thumbnails.append(thumbnail)
+    return distinct, sequence
+
+
+def process_animation(
+    path: str,
+    config: ProcessingConfig,
+    max_frames: int = MAX_PATTERNS,  # every frame may be distinct
+    dedupe_threshold: float = 2.0,
+    coherent: bool = True,
+    cache: Optional[StageCache] = None
+) -> AnimationResult:
+    """
+    Process every distinct frame of an animation like process_image. With
+    coherent, each frame's strokes are ordered starting from the previous
+    frame's and its tour starts where that one started, so the beam does
+    not jump around between frames that barely change. With a cache, each
+    frame's skeleton, path and angles are read back when their inputs
+    match; a coherent frame's path also depends on the previous one's.
+    """
+    try:
+        images, durations = load_frames(path, max_frames)
+    except FileNotFoundError as e:
+        return AnimationResult([], [], [], False, str(e))
+
+    grays = [prepare_gray(image) for image in images]
+    distinct, sequence = dedupe_frames(grays, dedupe_threshold)
+
+    def stage(key: str, compute: Callable[[], Any]) -> Any:
+        return compute() if cache is None else cache.get(key, compute)
+
+    frames: List[ProcessingResult] = []
+    skipped: List[int] = []
+    reference = None
+    reference_key = ""
+    try:
+        file_key = "" if cache is None else cache.file_key(path)
+        for number, index in enumerate(distinct):
+            skel_key = StageCache.key("frame skeleton", file_key, index, config.skeleton_method)
+            path_key = StageCache.key(
+                "frame path", skel_key, *config.path_inputs(), reference_key if coherent else ""
+            )
+
+            def path_stage() -> tuple:
+                skel = stage(skel_key, lambda: skeletonize(grays[index], config.skeleton_method))
+                path_out = skeleton_path(
+                    skel, config.max_points, config.detect_primitives, config.travel_budget_s,
+                    config.trace_graph, reference if coherent else None
+                )
+                return path_out, skel.shape
+
+            path_out, size = stage(path_key, path_stage)
+            raw_x, raw_y, laser = path_out[:3]
+            if not raw_x:
+                skipped.append(number)
+                frames.append(failure_result("No drawable content found in frame"))
+                continue
+            reference, reference_key = split_strokes(raw_x, raw_y, laser), path_key
+            angles = stage(
+                StageCache.key("angles", path_key, *config.geometry_inputs()),
+                lambda: path_angles(path_out, size[1], size[0], config)
+            )
+            frames.append(path_result(path_out, angles))
+    except Exception as e:
+        return AnimationResult([], [], [], False, f"Processing error: {str(e)}")
+
+    if len(skipped) == len(frames):
+        return AnimationResult([], [], [], False, "No drawable content found in animation")
+
+    points = sum(frame.point_count for frame in frames)
+    warnings = "".join(" Warning: frame {} has angles outside 0-90° range.".format(number)
+                       for number, frame in enumerate(frames) if "Warning" in frame.message)
+    empty = f" {len(skipped)} blank frames." if skipped else ""
+    return AnimationResult(
+        frames=frames,
+        sequence=sequence,
+        durations_ms=durations,
+        success=True,
+        message=(
+            f"Processed {len(images)} frames as {len(frames)} distinct, "
+            f"{points} points in all.{empty}{warnings}"
+        ),
+        skipped=skipped
+    )
+
+
+def animation_holds(result: AnimationResult, target_frame_ms: int = 0) -> List[Tuple[int, int]]:
+    """
+    (frame index, frames to draw it) in playing order. With the frame
+    governor's period, each source frame is held for as many laser frames
+    as cover its duration; without one every source frame is drawn once.
+    Runs of the same frame merge into one hold.
+    """
+    holds: List[Tuple[int, int]] = []
+    for index, duration in zip(result.sequence, result.durations_ms):
+        count = max(1, round(duration / target_frame_ms)) if target_frame_ms > 0 else 1
+        if holds and holds[-1][0] == index:
+            holds[-1] = (index, holds[-1][1] + count)
+        else:
+            holds.append((index, count))
+    return holds
+
+
+def save_animation_cpp(
+    output_path: str,
+    result: AnimationResult,
+    config: ProcessingConfig,
+    **options
+) -> str:
+    """
+    Generate and save the animation's sketch, returns the path. Blank frames
+    are left out and the frame before them is held through their time.
+    options go to generate_animation_cpp().
+    """
+    drawable = [i for i in range(len(result.frames)) if i not in result.skipped]
+    bank_index = {frame: bank for bank, frame in enumerate(drawable)}
+    patterns = [
+        Pattern(f"frame{frame}", result.frames[frame].x_angles,
+                result.frames[frame].y_angles, result.frames[frame].laser_states)
+        for frame in drawable
+    ]
+    holds: List[Tuple[int, int]] = []
+    for frame, count in animation_holds(result, options.get("target_frame_ms", 0)):
+        if frame not in bank_index:
+            if holds:
+                holds[-1] = (holds[-1][0], holds[-1][1] + count)  # the last drawing stays up
+            continue
+        if holds and holds[-1][0] == bank_index[frame]:
+            holds[-1] = (holds[-1][0], holds[-1][1] + count)
+        else:
+            holds.append((bank_index[frame], count))
+
+    cpp_code = generate_animation_cpp(
+        patterns, holds, config.wall_distance_meters, config.projected_size_meters, **options
+    )
+    path = Path(output_path)
+    path.write_text(cpp_code)
+    return str(path.absolute())
+
@@ -11,8 +11,9 @@ import threading
 from pathlib import Path
 import os
 
-from processor import ProcessingConfig, ProcessingResult, process_image
-from cpp_generator import save_cpp_file
+from processor import ProcessingConfig, ProcessingResult, ProcessingSession
+from stage_cache import StageCache
+from cpp_generator import save_cpp_file, step_resolution
 
 
 # === THEME CONFIGURATION ===
@@ -213,7 +214,7 @@ class DropZone(ctk.CTkFrame):
 class ParameterInput(ctk.CTkFrame):
     """Styled parameter input with label"""
     
-    def __init__(self, master, label, default_value, unit="", tooltip="", **kwargs):
+    def __init__(self, master, label, default_value, unit="", tooltip="", on_change=None, **kwargs):
         super().__init__(master, fg_color="transparent", **kwargs)
         
         # Label row
@@ -252,6 +253,8 @@ class ParameterInput(ctk.CTkFrame):
         )
         self.entry.insert(0, str(default_value))
         self.entry.pack(fill="x")
+        if on_change:
+            self.entry.bind("<KeyRelease>", lambda event: on_change())
         
         # Tooltip
         if tooltip:
@@ -349,13 +352,15 @@ class App(TkinterDnDCustom):
         super().__init__()
         
         self.title("EEGUI · Laser Projector Generator")
-        self.geometry("720x820")
-        self.minsize(640, 700)
+        self.geometry("720x900")
+        self.minsize(640, 780)
         self.configure(fg_color=COLORS["bg_dark"])
         
         # State
         self.current_image_path = None
         self.processing_result = None
+        self.session = ProcessingSession(StageCache())
+        self.processing = False
         
         self.create_ui()
     
@@ -418,7 +423,8 @@ class App(TkinterDnDCustom):
             label="Wall Distance",
             default_value="1.6",
             unit="meters",
-            tooltip="Distance from laser to wall"
+            tooltip="Distance from laser to wall",
+            on_change=self.update_geometry
         )
         self.wall_distance.grid(row=0, column=0, sticky="ew", padx=(0, 10), pady=(0, 16))
         
@@ -428,7 +434,8 @@ class App(TkinterDnDCustom):
             label="Projection Size",
             default_value="4.0",
             unit="meters",
-            tooltip="Max dimension of projection"
+            tooltip="Max dimension of projection",
+            on_change=self.update_geometry
         )
         self.projection_size.grid(row=0, column=1, sticky="ew", padx=(10, 0), pady=(0, 16))
         
@@ -448,10 +455,21 @@ class App(TkinterDnDCustom):
             label="Aspect Correction",
             default_value="1.0",
             unit="ratio",
-            tooltip="Vertical stretch factor"
+            tooltip="Vertical stretch factor",
+            on_change=self.update_geometry
         )
         self.aspect_ratio.grid(row=1, column=1, sticky="ew", padx=(10, 0), pady=(0, 0))
         
+        # Detail Levels
+        self.detail_levels = ParameterInput(
+            params_inner,
+            label="Detail Levels",
+            default_value="1",
+            unit="levels",
+            tooltip="Nested point subsets selectable on device"
+        )
+        self.detail_levels.grid(row=2, column=0, sticky="ew", padx=(0, 10), pady=(16, 0))
+        
         # === GENERATE BUTTON ===
         self.generate_btn = ctk.CTkButton(
             main,
@@ -482,15 +500,11 @@ class App(TkinterDnDCustom):
     def on_image_loaded(self, file_path: str):
         """Handle image loaded event"""
         self.current_image_path = file_path
+        self.processing_result = None
         self.status_bar.set_status(f"Image loaded: {Path(file_path).name}", "success")
     
-    def generate_code(self):
-        """Process image and generate C++ code"""
-        if not self.current_image_path:
-            self.status_bar.set_status("Please drop an image first", "warning")
-            return
-        
-        # Get parameters
+    def read_config(self):
+        """Parameters from the inputs, or None after reporting why they are invalid"""
         try:
             config = ProcessingConfig(
                 max_points=self.max_points.get_int(),
@@ -500,27 +514,63 @@ class App(TkinterDnDCustom):
             )
         except Exception as e:
             self.status_bar.set_status(f"Invalid parameters: {e}", "error")
-            return
+            return None
         
-        # Validate parameters
-        if config.max_points < 1:
-            self.status_bar.set_status("Max points must be at least 1", "error")
-            return
+        # Validate parameters (ProcessingConfig checks max points itself)
         if config.wall_distance_meters <= 0:
             self.status_bar.set_status("Wall distance must be positive", "error")
-            return
+            return None
         if config.projected_size_meters <= 0:
             self.status_bar.set_status("Projection size must be positive", "error")
+            return None
+        return config
+    
+    def update_geometry(self):
+        """Redo the angles and range check as projection parameters are typed"""
+        if self.processing or not self.current_image_path or self.processing_result is None:
+            return
+        config = self.read_config()
+        if config is None:
+            return
+        if not self.session.has_path(self.current_image_path, config):
+            self.status_bar.set_status("Path parameters changed - Generate to retrace", "info")
+            return
+        
+        result = self.session.process(self.current_image_path, config)
+        if not result.success:
+            self.status_bar.set_status(result.message, "error")
+            return
+        self.processing_result = result
+        angles = result.x_angles + result.y_angles
+        out_of_range = min(angles) < 0 or max(angles) > 90
+        self.status_bar.set_status(
+            f"{result.point_count} points at {config.wall_distance_meters}m"
+            + (" - some angles outside 0-90°" if out_of_range else " - all angles in range"),
+            "warning" if out_of_range else "success"
+        )
+    
+    def generate_code(self):
+        """Process image and generate C++ code"""
+        if not self.current_image_path:
+            self.status_bar.set_status("Please drop an image first", "warning")
+            return
+        
+        config = self.read_config()
+        if config is None:
+            return
+        if not 1 <= self.detail_levels.get_int() <= 8:
+            self.status_bar.set_status("Detail levels must be between 1 and 8", "error")
             return
         
         # Show processing state
+        self.processing = True
         self.generate_btn.configure(state="disabled", text="Processing...")
         self.status_bar.set_status("Processing image...", "processing")
         self.status_bar.show_progress()
         
-        # Process in background thread
+        # Process in background thread; only the stages whose inputs changed rerun
         def process():
-            result = process_image(self.current_image_path, config)
+            result = self.session.process(self.current_image_path, config)
             self.after(0, lambda: self.on_processing_complete(result, config))
         
         thread = threading.Thread(target=process, daemon=True)
@@ -528,6 +578,7 @@ class App(TkinterDnDCustom):
     
     def on_processing_complete(self, result: ProcessingResult, config: ProcessingConfig):
         """Handle processing completion"""
+        self.processing = False
         self.status_bar.hide_progress()
         self.generate_btn.configure(state="normal", text="Generate Arduino Code")
         
@@ -558,7 +609,8 @@ class App(TkinterDnDCustom):
                 result.y_angles,
                 result.laser_states,
                 config.wall_distance_meters,
-                config.projected_size_meters
+                config.projected_size_meters,
+                detail_levels=self.detail_levels.get_int()
             )
             
             self.status_bar.set_status(
@@ -566,13 +618,20 @@ class App(TkinterDnDCustom):
                 "success"
             )
             
+            resolution = step_resolution(
+                result.x_angles,
+                result.y_angles,
+                config.wall_distance_meters
+            )
+            
             # Show success dialog
             messagebox.showinfo(
                 "Success!",
                 f"Generated Arduino code with {result.point_count} points.\n\n"
                 f"File saved to:\n{output_path}\n\n"
                 f"Wall Distance: {config.wall_distance_meters}m\n"
-                f"Projection Size: {config.projected_size_meters}m"
+                f"Projection Size: {config.projected_size_meters}m\n"
+                f"Resolution: {resolution.summary()}"
             )
             
         except Exception as e:
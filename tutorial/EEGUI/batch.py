@@ -0,0 +1,214 @@
+"""
+Batch Converter for Laser Projector
+Headless image to Arduino code conversion for whole directories, on every core
+
+    python batch.py images/ "more/*.png" -o out --max-points 300 --jobs 8
+"""
+
+import argparse
+import csv
+import glob
+import json
+import os
+import sys
+import time
+from concurrent.futures import ProcessPoolExecutor, as_completed
+from dataclasses import asdict, dataclass
+from pathlib import Path
+from typing import Dict, List, Optional
+
+import cv2
+
+from cpp_generator import save_cpp_file
+from processor import MIN_POINTS, ProcessingConfig, process_image
+from stage_cache import StageCache
+
+IMAGE_EXTENSIONS = {".png", ".jpg", ".jpeg", ".bmp", ".gif", ".tif", ".tiff", ".webp"}
+
+
+@dataclass
+class ImageStats:
+    """One row of stats.csv"""
+    image: str
+    output: str
+    success: bool
+    points: int
+    lit_points: int
+    travel_px: float
+    path_error_px: float
+    seconds: float
+    message: str
+
+
+def find_images(inputs: List[str], recursive: bool = False) -> List[Path]:
+    """Image files named by files, directories or glob patterns, sorted, each once"""
+    found: Dict[Path, None] = {}
+    for item in inputs:
+        if Path(item).is_dir():
+            pattern = "**/*" if recursive else "*"
+            candidates = sorted(Path(item).glob(pattern))
+        elif Path(item).is_file():
+            candidates = [Path(item)]
+        else:
+            candidates = sorted(Path(p) for p in glob.glob(item, recursive=recursive))
+        for path in candidates:
+            if path.is_file() and path.suffix.lower() in IMAGE_EXTENSIONS:
+                found[path.resolve()] = None
+    return list(found)
+
+
+def output_names(images: List[Path]) -> List[str]:
+    """<stem>_laser.cpp per image, numbered where two images share a stem"""
+    names, used = [], set()
+    for image in images:
+        name, n = f"{image.stem}_laser.cpp", 2
+        while name in used:
+            name, n = f"{image.stem}_{n}_laser.cpp", n + 1
+        used.add(name)
+        names.append(name)
+    return names
+
+
+def _init_worker() -> None:
+    # One process per core already; OpenCV's own threads would only contend
+    cv2.setNumThreads(1)
+
+
+def convert_image(
+    image: str,
+    output: str,
+    config: ProcessingConfig,
+    detail_levels: int,
+    cache_dir: Optional[str]
+) -> ImageStats:
+    """Process one image and save its sketch (runs in a worker process)"""
+    start = time.perf_counter()
+    cache = StageCache(Path(cache_dir)) if cache_dir else None
+    result = process_image(image, config, cache)
+    message = result.message
+    if result.success:
+        try:
+            save_cpp_file(
+                output, result.x_angles, result.y_angles, result.laser_states,
+                config.wall_distance_meters, config.projected_size_meters,
+                detail_levels=detail_levels
+            )
+        except Exception as e:
+            result.success = False
+            message = f"Failed to save: {e}"
+    return ImageStats(
+        image=image,
+        output=output if result.success else "",
+        success=result.success,
+        points=result.point_count,
+        lit_points=sum(result.laser_states),
+        travel_px=round(result.travel_after, 1),
+        path_error_px=round(result.resample_error, 2),
+        seconds=round(time.perf_counter() - start, 3),
+        message=message
+    )
+
+
+def run_batch(
+    images: List[Path],
+    output_dir: Path,
+    config: ProcessingConfig,
+    detail_levels: int = 1,
+    jobs: Optional[int] = None,
+    cache_dir: Optional[str] = None
+) -> List[ImageStats]:
+    """Convert images across a process pool, writing stats.csv and summary.json to output_dir"""
+    output_dir.mkdir(parents=True, exist_ok=True)
+    start = time.perf_counter()
+    stats: List[ImageStats] = []
+    with ProcessPoolExecutor(max_workers=jobs, initializer=_init_worker) as pool:
+        futures = [
+            pool.submit(convert_image, str(image), str(output_dir / name), config, detail_levels, cache_dir)
+            for image, name in zip(images, output_names(images))
+        ]
+        for done, future in enumerate(as_completed(futures), 1):
+            row = future.result()
+            stats.append(row)
+            mark = "ok " if row.success else "ERR"
+            print(f"[{done}/{len(images)}] {mark} {Path(row.image).name}: {row.message}", flush=True)
+    elapsed = time.perf_counter() - start
+    stats.sort(key=lambda row: row.image)
+
+    with open(output_dir / "stats.csv", "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(ImageStats.__dataclass_fields__))
+        writer.writeheader()
+        writer.writerows(asdict(row) for row in stats)
+
+    converted = [row for row in stats if row.success]
+    summary = {
+        "images": len(stats),
+        "converted": len(converted),
+        "failed": [row.image for row in stats if not row.success],
+        "total_points": sum(row.points for row in converted),
+        "worst_path_error_px": max((row.path_error_px for row in converted), default=0.0),
+        "image_seconds": round(sum(row.seconds for row in stats), 2),  # summed per image
+        "wall_seconds": round(elapsed, 2),
+        "config": asdict(config),
+    }
+    with open(output_dir / "summary.json", "w") as f:
+        json.dump(summary, f, indent=2)
+    return stats
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    defaults = ProcessingConfig()
+    parser = argparse.ArgumentParser(description="Convert images to laser projector Arduino sketches")
+    parser.add_argument("inputs", nargs="+", help="image files, directories or glob patterns")
+    parser.add_argument("-o", "--output-dir", default="laser_out", help="where sketches and stats go")
+    parser.add_argument("-r", "--recursive", action="store_true", help="descend into directories, ** in globs")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="worker processes")
+    parser.add_argument("--max-points", type=int, default=defaults.max_points)
+    parser.add_argument("--wall-distance", type=float, default=defaults.wall_distance_meters, help="meters")
+    parser.add_argument("--projection-size", type=float, default=defaults.projected_size_meters, help="meters")
+    parser.add_argument("--aspect", type=float, default=defaults.aspect_ratio_correction)
+    parser.add_argument("--simplify-mm", type=float, default=defaults.simplify_tolerance_mm)
+    parser.add_argument("--skeleton", default=defaults.skeleton_method,
+                        choices=["morphological", "zhang_suen", "guo_hall"])
+    parser.add_argument("--primitives", action="store_true", help="draw lines, circles and arcs as primitives")
+    parser.add_argument("--trace-graph", action="store_true",
+                        help="walk the skeleton's branches into strokes instead of chaining nearest pixels")
+    parser.add_argument("--detail-levels", type=int, default=1)
+    parser.add_argument("--cache-dir", default=None, help="stage cache (default ~/.cache/eegui)")
+    parser.add_argument("--no-cache", action="store_true")
+    parser.add_argument("--clear-cache", action="store_true", help="empty the stage cache before converting")
+    args = parser.parse_args(argv)
+
+    images = find_images(args.inputs, args.recursive)
+    if not images:
+        print("No images found", file=sys.stderr)
+        return 2
+    if args.max_points < MIN_POINTS or args.wall_distance <= 0 or args.projection_size <= 0:
+        print(f"Max points must be at least {MIN_POINTS}, distance and size positive", file=sys.stderr)
+        return 2
+
+    config = ProcessingConfig(
+        max_points=args.max_points,
+        wall_distance_meters=args.wall_distance,
+        projected_size_meters=args.projection_size,
+        aspect_ratio_correction=args.aspect,
+        detect_primitives=args.primitives,
+        trace_graph=args.trace_graph,
+        skeleton_method=args.skeleton,
+        simplify_tolerance_mm=args.simplify_mm
+    )
+    cache = StageCache(args.cache_dir)
+    if args.clear_cache:
+        cache.clear()
+    cache_dir = None if args.no_cache else str(cache.directory)
+    output_dir = Path(args.output_dir)
+    stats = run_batch(images, output_dir, config, args.detail_levels, args.jobs, cache_dir)
+    if cache_dir:
+        cache.prune()  # each worker's cache only lives for one image
+
+    failed = sum(1 for row in stats if not row.success)
+    print(f"{len(stats) - failed}/{len(stats)} converted, stats in {output_dir / 'stats.csv'}")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
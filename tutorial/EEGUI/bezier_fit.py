@@ -0,0 +1,192 @@
+"""
+Cubic Bezier Fitting for Laser Projector
+Replaces runs of lit points with cubic segments within an error bound
+"""
+
+import math
+from dataclasses import dataclass
+from typing import List, Tuple
+
+Point = Tuple[float, float]
+
+MAX_ITERATIONS = 4  # Newton reparameterisation passes before splitting
+
+
+@dataclass
+class CurveElement:
+    """
+    One element of a curve path: a cubic from the previous element's end
+    point, or a blanked jump to `end` when lit is False
+    """
+    control1: Point
+    control2: Point
+    end: Point
+    lit: bool
+
+
+def _sub(a: Point, b: Point) -> Point:
+    return (a[0] - b[0], a[1] - b[1])
+
+
+def _add(a: Point, b: Point) -> Point:
+    return (a[0] + b[0], a[1] + b[1])
+
+
+def _scale(a: Point, s: float) -> Point:
+    return (a[0] * s, a[1] * s)
+
+
+def _dot(a: Point, b: Point) -> float:
+    return a[0] * b[0] + a[1] * b[1]
+
+
+def _dist(a: Point, b: Point) -> float:
+    return math.hypot(a[0] - b[0], a[1] - b[1])
+
+
+def _unit(a: Point) -> Point:
+    length = math.hypot(a[0], a[1])
+    return (a[0] / length, a[1] / length) if length > 1e-12 else (0.0, 0.0)
+
+
+def bezier_point(p0: Point, p1: Point, p2: Point, p3: Point, t: float) -> Point:
+    """Evaluate a cubic at parameter t"""
+    s = 1.0 - t
+    b0, b1, b2, b3 = s * s * s, 3 * s * s * t, 3 * s * t * t, t * t * t
+    return (
+        b0 * p0[0] + b1 * p1[0] + b2 * p2[0] + b3 * p3[0],
+        b0 * p0[1] + b1 * p1[1] + b2 * p2[1] + b3 * p3[1]
+    )
+
+
+def _line(p0: Point, p3: Point) -> Tuple[Point, Point]:
+    """Controls that make a cubic a straight segment"""
+    return _add(p0, _scale(_sub(p3, p0), 1 / 3)), _add(p0, _scale(_sub(p3, p0), 2 / 3))
+
+
+def _chord_parameters(points: List[Point]) -> List[float]:
+    u = [0.0]
+    for i in range(1, len(points)):
+        u.append(u[-1] + _dist(points[i], points[i - 1]))
+    total = u[-1] or 1.0
+    return [v / total for v in u]
+
+
+def _fit_cubic_tangents(
+    points: List[Point], u: List[float], tan1: Point, tan2: Point
+) -> Tuple[Point, Point]:
+    """Least-squares control lengths along fixed end tangents (Schneider)"""
+    p0, p3 = points[0], points[-1]
+    c00 = c01 = c11 = x0 = x1 = 0.0
+    for point, t in zip(points, u):
+        s = 1.0 - t
+        a1 = _scale(tan1, 3 * s * s * t)
+        a2 = _scale(tan2, 3 * s * t * t)
+        c00 += _dot(a1, a1)
+        c01 += _dot(a1, a2)
+        c11 += _dot(a2, a2)
+        base = bezier_point(p0, p0, p3, p3, t)
+        diff = _sub(point, base)
+        x0 += _dot(a1, diff)
+        x1 += _dot(a2, diff)
+    det = c00 * c11 - c01 * c01
+    chord = _dist(p0, p3)
+    alpha1 = alpha2 = 0.0
+    if abs(det) > 1e-12:
+        alpha1 = (x0 * c11 - x1 * c01) / det
+        alpha2 = (c00 * x1 - c01 * x0) / det
+    # Degenerate or backwards fits fall back to the Wu/Barsky heuristic
+    epsilon = 1e-6 * chord
+    if alpha1 < epsilon or alpha2 < epsilon:
+        alpha1 = alpha2 = chord / 3
+    return _add(p0, _scale(tan1, alpha1)), _add(p3, _scale(tan2, alpha2))
+
+
+def _max_error(points: List[Point], bezier: Tuple[Point, ...], u: List[float]) -> Tuple[float, int]:
+    worst, split = 0.0, len(points) // 2
+    for i in range(1, len(points) - 1):
+        error = _dist(bezier_point(*bezier, u[i]), points[i])
+        if error > worst:
+            worst, split = error, i
+    return worst, split
+
+
+def _reparameterize(points: List[Point], bezier: Tuple[Point, ...], u: List[float]) -> List[float]:
+    """One Newton-Raphson step towards each point's closest parameter"""
+    p0, p1, p2, p3 = bezier
+    d1 = [_scale(_sub(p1, p0), 3), _scale(_sub(p2, p1), 3), _scale(_sub(p3, p2), 3)]
+    d2 = [_scale(_sub(d1[1], d1[0]), 2), _scale(_sub(d1[2], d1[1]), 2)]
+    result = []
+    for point, t in zip(points, u):
+        s = 1.0 - t
+        q = bezier_point(p0, p1, p2, p3, t)
+        q1 = _add(_add(_scale(d1[0], s * s), _scale(d1[1], 2 * s * t)), _scale(d1[2], t * t))
+        q2 = _add(_scale(d2[0], s), _scale(d2[1], t))
+        diff = _sub(q, point)
+        denominator = _dot(q1, q1) + _dot(diff, q2)
+        result.append(min(1.0, max(0.0, t - _dot(diff, q1) / denominator)) if denominator else t)
+    return result
+
+
+def _fit_run(points: List[Point], tan1: Point, tan2: Point, tolerance: float) -> List[Tuple[Point, Point, Point]]:
+    """Fit one lit run, splitting at the worst point until every piece fits"""
+    if len(points) == 2:
+        c1, c2 = _line(points[0], points[1])
+        return [(c1, c2, points[1])]
+
+    u = _chord_parameters(points)
+    for _ in range(MAX_ITERATIONS + 1):
+        c1, c2 = _fit_cubic_tangents(points, u, tan1, tan2)
+        bezier = (points[0], c1, c2, points[-1])
+        error, split = _max_error(points, bezier, u)
+        if error <= tolerance:
+            return [(c1, c2, points[-1])]
+        u = _reparameterize(points, bezier, u)
+
+    center = _unit(_sub(points[split - 1], points[split + 1]))
+    if center == (0.0, 0.0):
+        center = _unit(_sub(points[split - 1], points[split]))
+    left = _fit_run(points[:split + 1], tan1, center, tolerance)
+    right = _fit_run(points[split:], _scale(center, -1), tan2, tolerance)
+    return left + right
+
+
+def fit_curve_path(
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    tolerance: float
+) -> List[CurveElement]:
+    """
+    Turn a point path into curve elements no further than tolerance (same
+    unit as the angles) from any input point. Element 0 reaches point 0 from
+    the last point, lit or blanked as laser_states[0] says; each run of lit
+    moves becomes cubics and each blanked move a jump.
+    """
+    points = list(zip(x_angles, y_angles))
+    n = len(points)
+    if n == 0:
+        return []
+
+    if laser_states[0] and n > 1:
+        c1, c2 = _line(points[-1], points[0])
+        elements = [CurveElement(c1, c2, points[0], True)]
+    else:
+        elements = [CurveElement(points[0], points[0], points[0], False)]
+
+    i = 1
+    while i < n:
+        if not laser_states[i]:
+            elements.append(CurveElement(points[i], points[i], points[i], False))
+            i += 1
+            continue
+        run_end = i
+        while run_end + 1 < n and laser_states[run_end + 1]:
+            run_end += 1
+        run = points[i - 1:run_end + 1]
+        tan1 = _unit(_sub(run[1], run[0]))
+        tan2 = _unit(_sub(run[-2], run[-1]))
+        for c1, c2, end in _fit_run(run, tan1, tan2, tolerance):
+            elements.append(CurveElement(c1, c2, end, True))
+        i = run_end + 1
+    return elements
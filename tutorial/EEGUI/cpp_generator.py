@@ -3,141 +3,2508 @@ C++ Code Generator for Arduino Laser Projector
 Generates complete .cpp file with embedded angle data
 """
 
-from typing import List
+import heapq
+import math
+import struct
+from dataclasses import dataclass
+from typing import List, Optional, Tuple, Union
 from pathlib import Path
 
+from bezier_fit import CurveElement, fit_curve_path
+
+
+# Stepper defaults baked into the generated sketch
+STEPS_PER_REV = 200
+MICROSTEPS = 0.25
+HOME_STEPS = 40  # setCurrentPosition() value in the sketch's setup()
+
+# Pattern record layout and EEPROM upload framing (see the sketch's PATTERN BANK)
+ANGLE_MASK = 0x3FFF
+WALL_OFFSET = 8192  # wall-space records: offset-binary half millimetres
+WALL_UNITS_PER_MM = 2
+UPLOAD_CHUNK = 16
+MAX_PATTERNS = 254  # byte pattern indices, the last two are the EEPROM and SD slots
+
+# Sketch log levels and binary trace records (see the sketch's LOGGING)
+LOG_LEVELS = {"off": 0, "warn": 1, "info": 2, "debug": 3}
+TRACE_SYNC = 0xA5
+TRACE_RECORD = struct.Struct("<BBHi")  # type, detail, millis() & 0xFFFF, value
+TRACE_TYPES = {1: "move", 2: "frame", 3: "missed", 4: "pattern", 5: "cue", 6: "dropped"}
+
+# MS3/MS2/MS1 pin patterns per microstep divisor (bit0 = MS1)
+MS_PATTERNS = {
+    "a4988": {1: 0b000, 2: 0b001, 4: 0b010, 8: 0b011, 16: 0b111},
+    "drv8825": {1: 0b000, 2: 0b001, 4: 0b010, 8: 0b011, 16: 0b100, 32: 0b101},
+}
+
+
+@dataclass
+class StepResolution:
+    """Effective resolution of the generated player for one point set"""
+    steps_per_degree: float
+    degrees_per_step: float
+    wall_mm_per_step: float
+    truncated_error: float  # worst |landed - exact| in steps with a (long) cast
+    rounded_error: float    # the same for the player's rounding
+    collapsed: int          # distinct points lost to landing on the same step as another
+    point_count: int
+
+    def summary(self) -> str:
+        return (
+            f"{self.steps_per_degree:.3f} steps/deg "
+            f"({self.degrees_per_step:.2f} deg/step, ~{self.wall_mm_per_step:.0f}mm on wall) | "
+            f"worst error {self.rounded_error:.2f} step (truncated {self.truncated_error:.2f}), "
+            f"{self.collapsed}/{self.point_count} points merge into another on the same step"
+        )
+
+
+@dataclass
+class MicrostepPlan:
+    """Outcome of replaying the player's jump logic on the host"""
+    jump_count: int
+    draw_pulses: int
+    jump_pulses: int
+    frames: int
+
+    def summary(self) -> str:
+        return (
+            f"{self.jump_count} jumps, {self.jump_pulses} step pulses "
+            f"instead of {self.draw_pulses} over {self.frames} frames"
+        )
+
+
+@dataclass
+class Pattern:
+    """One drawable pattern for the sketch's pattern bank"""
+    name: str
+    x_angles: List[float]
+    y_angles: List[float]
+    laser_states: List[bool]
+
+
+@dataclass
+class Shape:
+    """
+    Procedural pattern evaluated by the player, angles in degrees.
+    freq_a is the polygon's side count, the Lissajous X frequency or the
+    number of sine cycles; freq_b is the Lissajous Y frequency.
+    """
+    name: str
+    kind: str
+    center_x: float
+    center_y: float
+    radius_x: float
+    radius_y: float
+    points: int = 64
+    start_deg: float = 0.0
+    sweep_deg: float = 180.0
+    freq_a: int = 1
+    freq_b: int = 1
+
+
+@dataclass
+class Cue:
+    """
+    One step of a show timeline: play patterns[pattern] for `frames` complete
+    frames, or for duration_ms when frames is 0, after a blank_ms blanked
+    transition. Index len(patterns) is the EEPROM slot, the next one the SD show.
+    """
+    pattern: int
+    frames: int = 1
+    duration_ms: int = 0
+    blank_ms: int = 0
+
+
+@dataclass
+class TraceEvent:
+    """One binary trace record from a sketch built with the debug log level"""
+    kind: str
+    detail: int
+    time_ms: int  # low 16 bits of the sketch's millis()
+    value: int
+
+
+@dataclass
+class PreparedPattern:
+    """A pattern after playback planning and record encoding"""
+    name: str
+    records: List[int]
+    playback_mode: int
+    comments: List[str]
+    shape: Optional[Shape] = None
+    curve: bool = False
+
+    @property
+    def table_count(self) -> int:
+        """Count column of the sketch's pattern table: points, or curve elements"""
+        if self.shape:
+            return self.shape.points
+        return len(self.records) // (6 if self.curve else 2)
+
 
 CPP_TEMPLATE = '''// Dual Stepper Motor X-Y Angle Control
 // SMOOTH SPLINE DATA PLAYER
 // Generated by EEGUI Laser Projector Tool
 
 #include <AccelStepper.h>
+#include <EEPROM.h>
 
 // --- LASER SETUP ---
 #define LASER_PIN 7
 
+// --- LASER POWER ---
+// With LASER_PWM 1 the laser's TTL input must sit on a PWM pin (6 on an
+// Uno). Power then follows the beam speed, so slow corners don't burn
+// brighter than fast runs: full power at LASER_FULL_POWER_SPEED steps/s,
+// never less than LASER_MIN_DUTY while the laser is on.
+#define LASER_PWM {laser_pwm}
+#define LASER_PWM_PIN 6
+#define LASER_FULL_POWER_SPEED {laser_full_power_speed}
+#define LASER_MIN_DUTY 24
+#define LASER_PWM_UPDATE_US 1000
+
 // --- PINS ---
 #define X_STEP_PIN 2
 #define X_DIR_PIN 3
 #define Y_STEP_PIN 4
 #define Y_DIR_PIN 5
 
+// --- BOARD ---
+// The player runs as two sides joined by a lock-free single-producer
+// single-consumer queue: the decode side (Serial, button, cues, pattern
+// decoding) pushes moves, the motion side (steppers, laser, dwells) plays
+// them. An AVR takes turns between the sides in loop(); a dual-core ESP32
+// gives the motion side core 0 to itself; a host build (no ARDUINO, see
+// host/build.py) runs it on a POSIX thread so the queue and the threading
+// can be tested off-board.
+#define BOARD_AVR 0
+#define BOARD_DUAL_CORE 1
+#define BOARD_HOST 2
+#ifndef BOARD
+#if defined(ARDUINO_ARCH_ESP32)
+#define BOARD BOARD_DUAL_CORE
+#elif defined(ARDUINO)
+#define BOARD BOARD_AVR
+#else
+#define BOARD BOARD_HOST
+#endif
+#endif
+#if BOARD == BOARD_AVR
+#define MOTION_QUEUE_SIZE 4    // power of two, at most 128
+#else
+#define MOTION_QUEUE_SIZE 32
+#define MOTION_CORE 0
+#endif
+
 // --- MOTOR SETTINGS ---
-#define STEPS_PER_REV 200  
-#define MICROSTEPS 0.25    
+#define STEPS_PER_REV {steps_per_rev}
+#define MICROSTEPS {microsteps}
+
+// --- STEP ROUNDING ---
+// Every target is rounded to the nearest whole step of its exact position
+// instead of truncated, so no point lands more than half a step off and
+// the same angle always lands on the same step, frame after frame.
+
+// --- MICROSTEP SWITCHING ---
+// With MS1-MS3 of both drivers wired to the pins below, long blanked jumps
+// run in the coarse jump mode and everything else in the MICROSTEPS mode.
+// Positions are tracked in drawing steps and only rescaled on a jump-step
+// boundary, so no step is ever lost across a switch.
+#define MICROSTEP_SWITCHING {microstep_switching}
+#define MS1_PIN 8
+#define MS2_PIN 9
+#define MS3_PIN 10
+#define DRAW_MS_PATTERN {draw_ms_pattern}  // bit0 = MS1, bit1 = MS2, bit2 = MS3
+#define JUMP_MS_PATTERN {jump_ms_pattern}
+#define JUMP_STEP_RATIO {jump_step_ratio}  // drawing steps per jump step
+#define JUMP_MIN_STEPS {jump_min_steps}   // shorter blanked moves stay in drawing mode
+
+// --- PLAYBACK ---
+// LOOP restarts from point 0 after a blanked pause, WRAP flows straight
+// from the last point back into the first (closed paths), PINGPONG plays
+// open paths forwards then backwards so there is no flyback at all.
+#define PLAYBACK_LOOP 0
+#define PLAYBACK_WRAP 1
+#define PLAYBACK_PINGPONG 2
+
+// --- FRAME GOVERNOR ---
+// Holds every frame (one pass over the points) to TARGET_FRAME_MS. Short
+// frames are padded with a blanked dwell; long frames first raise the
+// stepper speed, then skip points (stride) until they fit. 0 disables it.
+#define TARGET_FRAME_MS {target_frame_ms}
+#define BASE_MAX_SPEED 100
+#define BASE_ACCELERATION 50
+#define MAX_SPEED_SCALE 4
+#define MAX_POINT_STRIDE 4
+#define TELEMETRY_INTERVAL_MS 1000
+
+// --- LOGGING ---
+// LOG_LEVEL compiles out everything above it: LOG_WARN keeps the missed
+// frame report and skipped cues, LOG_INFO adds the startup banner and
+// LOG_DEBUG adds binary trace events. Replies to Serial commands are not
+// logging and always stay.
+// Trace events wait in a ring buffer and are only written into free UART
+// transmit space, so tracing never blocks playback. On the wire each is
+// TRACE_SYNC, type, detail, the low 16 bits of millis() and a 32-bit
+// value, little-endian.
+#define LOG_OFF 0
+#define LOG_WARN 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+#define LOG_LEVEL {log_level}
+#define TRACE_SYNC 0xA5
+#define TRACE_RECORD_BYTES 9
+#define TRACE_MOVE 1     // detail = laser, value = point index
+#define TRACE_FRAME 2    // detail = speed scale, value = frame ms
+#define TRACE_MISSED 3   // value = frame ms
+#define TRACE_PATTERN 4  // detail = pattern, value = points
+#define TRACE_CUE 5      // detail = cue, value = pattern
+#define TRACE_DROPPED 6  // value = events lost to a full buffer
+#if BOARD == BOARD_AVR
+#define TRACE_BUFFER_SIZE 16  // events, power of two
+#else
+#define TRACE_BUFFER_SIZE 64
+#endif
+#if LOG_LEVEL >= LOG_DEBUG
+#define LOG_EVENT(type, detail, value) traceEvent(type, detail, value)
+#else
+#define LOG_EVENT(type, detail, value)
+#endif
+
+// --- DETAIL LEVELS ---
+// Every point carries the coarsest detail level it belongs to, so level 0
+// is a sketch of the image and DETAIL_LEVELS - 1 plays every point. Send
+// "L<n>" over Serial to pin a level, "LA" to let the governor choose.
+#define DETAIL_LEVELS {detail_levels}
+
+// --- WALL SPACE ---
+// With WALL_SPACE set, record words hold positions on the wall instead of
+// angles: offset-binary half millimetres from the centre of the
+// projection, x right and y down as in the image. The player turns them
+// into angles through a fixed-point atan table, so "D<mm>" (wall
+// distance) and "S<mm>" (projection size) recalibrate without
+// regenerating the data. Shapes stay in angle space.
+// "J<dx>,<dy>,<laser>" moves a live wall-space cursor by a delta in half
+// millimetres, holding pattern playback until the next "P<n>" or "T".
+#define WALL_SPACE {wall_space}
+#define WALL_OFFSET 8192
+#define WALL_DISTANCE_MM {wall_distance_mm}
+#define PROJECTION_MM {projection_mm}
+
+// atan() in millidegrees for ratios 0 to 1 in 64 slots
+const unsigned int atanTable[65] PROGMEM = {{
+  0, 895, 1790, 2684, 3576, 4467, 5356, 6242, 7125, 8005, 8881,
+  9752, 10620, 11482, 12339, 13191, 14036, 14876, 15709, 16535, 17354, 18166,
+  18970, 19767, 20556, 21337, 22109, 22874, 23629, 24376, 25115, 25844, 26565,
+  27277, 27979, 28673, 29358, 30033, 30700, 31357, 32005, 32645, 33275, 33896,
+  34509, 35112, 35707, 36293, 36870, 37439, 37999, 38550, 39094, 39629, 40156,
+  40675, 41186, 41689, 42184, 42672, 43152, 43625, 44091, 44549, 45000
+}};
+
+// --- PATTERN BANK ---
+// Every pattern is stored in flash as two words per point: 14-bit angles
+// in hundredths of a degree, with the laser flag and level bit 0 on top of
+// the X word and level bits 1-2 on top of the Y word. "P<n>" over Serial
+// or a press on PATTERN_BUTTON_PIN switches patterns between two points.
+// "U<count>,<mode>" followed by the raw records (acknowledged with '.'
+// every UPLOAD_CHUNK bytes) and an XOR checksum stores one more pattern
+// in EEPROM, selectable right after the flash patterns.
+#define PATTERN_BUTTON_PIN A0
+#define BUTTON_DEBOUNCE_MS 50
+#define ANGLE_MASK 0x3FFF
+#define LASER_BIT 0x4000
+#define LEVEL_BIT 0x8000
+#define UPLOAD_CHUNK 16
+#define EEPROM_MAGIC 0xA5
+#define EEPROM_HEADER 4  // magic, playback mode, point count (2 bytes)
+#if BOARD == BOARD_DUAL_CORE
+// The ESP32 EEPROM is a RAM copy of a flash sector: sized in setup() and
+// only written back to flash by a commit. Its write() skips unchanged bytes.
+#define EEPROM_SIZE 1024
+#define EEPROM_UPDATE(address, value) EEPROM.write(address, value)
+#define EEPROM_COMMIT() EEPROM.commit()
+#else
+#define EEPROM_UPDATE(address, value) EEPROM.update(address, value)
+#define EEPROM_COMMIT()
+#endif
+
+#define SOURCE_FLASH 0
+#define SOURCE_EEPROM 1
+#define SOURCE_SD 2
+#define SOURCE_SHAPE 3
+#define SOURCE_CURVE 4
+
+// --- SHAPE PRIMITIVES ---
+// Circles, arcs, polygons, Lissajous figures and sine waves are stored as
+// a few parameters and evaluated on the player one point at a time, so
+// the point count in the pattern table only sets the sampling density.
+// Positions are in hundredths of a degree and phases in 1/65536 of a
+// turn. Sines come from a quarter-wave table with linear interpolation.
+#define SHAPE_CIRCLE 0
+#define SHAPE_ARC 1
+#define SHAPE_POLYGON 2
+#define SHAPE_LISSAJOUS 3
+#define SHAPE_SINE 4
+
+struct Shape {{
+  byte type;
+  int centerX, centerY;
+  int radiusX, radiusY;  // half the width and height
+  unsigned int phase;    // start phase
+  long sweep;            // arc only, +-65535
+  byte freqA, freqB;     // polygon sides, Lissajous frequencies, sine cycles
+}};
+
+// sin() over the first quarter turn in 64 slots, scaled to 16384
+const int sineTable[65] PROGMEM = {{
+  0, 402, 804, 1205, 1606, 2006, 2404, 2801, 3196, 3590, 3981, 4370, 4756,
+  5139, 5520, 5897, 6270, 6639, 7005, 7366, 7723, 8076, 8423, 8765, 9102, 9434,
+  9760, 10080, 10394, 10702, 11003, 11297, 11585, 11866, 12140, 12406, 12665, 12916, 13160,
+  13395, 13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978, 15137, 15286, 15426, 15557,
+  15679, 15791, 15893, 15986, 16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379, 16384
+}};
+
+// --- CURVES ---
+// A curve pattern stores cubic Bezier elements of three points each:
+// control 1, control 2 and end, two record words per point, starting from
+// the previous element's end. The laser bit on the end point marks a drawn
+// element, the rest are blanked jumps. Elements are sampled curveSamples
+// times with forward differencing in 16.16 fixed point, snapping to the
+// stored end point. "C<n>" over Serial changes the sampling density.
+#define CURVE_SAMPLES {curve_samples}
+#define CURVE_MAX_SAMPLES 64
+#define CURVE_ONE 65536L
+#define LEVEL_HIDDEN 255  // jump samples before the end are never played
+
+struct Pattern {{
+  const uint16_t *records;  // PROGMEM, two words per point
+  long count;               // points, or elements for a curve
+  byte playbackMode;
+  const Shape *shape;       // PROGMEM, replaces records when not NULL
+  bool curve;               // records hold curve elements
+}};
+
+// --- SHOW TIMELINE ---
+// Cues play in order and the timeline loops. A cue ends after `frames`
+// complete frames, or after durationMs when frames is 0. The travel to the
+// next cue's first point is always blanked, and the beam stays parked
+// there until blankMs after the cue change. "P<n>" or the button stops the
+// timeline, "T" restarts it from the first cue.
+#define SHOW_CUES {cue_count}
+
+struct Cue {{
+  byte pattern;
+  byte frames;
+  unsigned int durationMs;
+  unsigned int blankMs;
+}};
+
+// --- SD STREAMING ---
+// Plays SD_SHOW_FILE from a FAT card as the pattern after the EEPROM slot,
+// for shows that don't fit in flash. Block 0 of the file is a header, the
+// records (same layout as flash) follow from block 1. Two block buffers
+// alternate: the one under the cursor is played while the next block in
+// the play direction is read ahead. With the motion side on its own core
+// or thread, the decode side reads whenever a block is due. On a single
+// core (AVR) the motion side reads ahead itself, between two points while
+// both steppers are at rest, so a read delays the next move a little
+// instead of stalling one halfway; a block still missing when the cursor
+// reaches it waits for the queue to drain first.
+// Each buffer takes SD_BLOCK_SIZE bytes of RAM on top of the SD library's
+// own block cache, so this wants a board with more SRAM than an Uno.
+// Off the Arduino build the block device is a plain file (host testing).
+#define SD_STREAMING {sd_streaming}
+#define SD_CS_PIN A2
+#define SD_SHOW_FILE "SHOW.BIN"
+#define SD_BLOCK_SIZE 512
+#define SD_RECORDS_PER_BLOCK (SD_BLOCK_SIZE / 4)
+#define SD_MAGIC "EELS"
 
 AccelStepper stepperX(AccelStepper::DRIVER, X_STEP_PIN, X_DIR_PIN);
 AccelStepper stepperY(AccelStepper::DRIVER, Y_STEP_PIN, Y_DIR_PIN);
 
-// --- GENERATED DATA ({point_count} points) ---
+// --- GENERATED DATA ({pattern_count} patterns, {point_count} points) ---
 // Wall Distance: {wall_distance}m | Projection Size: {projection_size}m
-
-const float xAngles[] = {x_angles};
-const float yAngles[] = {y_angles};
-const bool laserValues[] = {laser_values};
+{pattern_data}
+const Pattern patterns[] = {{
+{pattern_table}
+}};
+const byte patternCount = sizeof(patterns) / sizeof(patterns[0]);
+{cue_table}
 
 // --- VARIABLES ---
-int numAngles = sizeof(xAngles) / sizeof(xAngles[0]);
-int currentIndex = 0;
+byte currentPattern = 0;
+byte patternSource = SOURCE_FLASH;
+const uint16_t *patternRecords = NULL;
+byte playbackMode = PLAYBACK_LOOP;
+long numAngles = 0;
+long currentIndex = 0;
+long lastIndex = -1;    // point the beam is coming from, -1 after a restart,
+                        // numAngles across a WRAP seam
+int playDirection = 1;  // -1 while a ping-pong pass runs backwards
+int pointStride = 1;    // governor: points advanced per move
+byte speedScale = 1;    // governor: multiple of BASE_MAX_SPEED
+unsigned long frameStartMs = 0;
+unsigned long lastReportMs = 0;
+unsigned long missedFrames = 0;
+bool laserEnabled = false;
+unsigned long lastPowerUpdateUs = 0;
+byte detailLevel = DETAIL_LEVELS - 1;
+bool detailPinned = false;          // set by the "L<n>" Serial command
+long levelPointCount[DETAIL_LEVELS]; // points played at each detail level
+char commandBuffer[16];
+byte commandLength = 0;
+long uploadRemaining = 0;  // record bytes still expected, plus the checksum
+int uploadAddress = 0;
+int uploadCount = 0;
+byte uploadMode = PLAYBACK_LOOP;
+byte uploadChecksum = 0;
+bool buttonWasDown = false;
+unsigned long buttonChangeMs = 0;
+long wallDistanceMm = WALL_DISTANCE_MM;
+long projectionMm = PROJECTION_MM;
+bool liveMode = false;  // "J" cursor has the beam
+long liveX = 0;         // half millimetres from the centre
+long liveY = 0;
+Shape activeShape;
+long shapeIndex = -1;  // point held in shapeX/shapeY
+int shapeX = 0;
+int shapeY = 0;
+byte curveSamples = CURVE_SAMPLES;
+long curveElements = 0;
+long curveElement = -1;     // element loaded into curveX/curveY
+int curveStep = -1;         // sample held there, -1 for the element's start
+long curveX[4];             // position and 3 forward differences, 16.16
+long curveY[4];
+bool showRunning = SHOW_CUES > 0;
+byte cueIndex = 0;
+byte cueFrames = 0;           // frames completed in the current cue
+bool cueTravel = false;       // next move is the blanked travel into a cue
+unsigned long cueStartMs = 0; // end of the cue's blank hold
+
+// --- MOTION QUEUE ---
+// Each index is written by one side only; the other side reads it with
+// acquire ordering, so a slot is complete before it becomes visible.
+// A command stays queued until it has finished playing, so an empty
+// queue means the motion side is idle.
+#define MOTION_MOVE 0   // laser, then move to the angles
+#define MOTION_LASER 1  // laser only
+#define MOTION_DWELL 2  // blanked hold
+#define MOTION_SPEED 3  // new speed scale
+
+struct MotionCommand {{
+  byte kind;
+  bool laserOn;
+  byte speedScale;
+  unsigned int dwellMs;
+  float xAngle;
+  float yAngle;
+}};
+
+#if BOARD == BOARD_AVR
+#define QUEUE_LOAD(index) (index)
+#define QUEUE_STORE(index, value) ((index) = (value))
+#else
+#define QUEUE_LOAD(index) __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define QUEUE_STORE(index, value) __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+#endif
+
+MotionCommand motionQueue[MOTION_QUEUE_SIZE];
+byte motionHead = 0;       // next free slot, decode side
+byte motionTail = 0;       // command playing or next up, motion side
+bool motionBusy = false;   // motion side: the tail command has started
+
+#if BOARD == BOARD_DUAL_CORE
+TaskHandle_t motionTask;
+#elif BOARD == BOARD_HOST
+#include <pthread.h>
+#include <sched.h>
+pthread_t motionThread;
+#endif
+
+#if LOG_LEVEL >= LOG_DEBUG
+// Written and drained by the decode side only
+struct TraceEvent {{
+  byte type;
+  byte detail;
+  uint16_t timeMs;
+  long value;
+}};
+TraceEvent traceBuffer[TRACE_BUFFER_SIZE];
+byte traceHead = 0;
+byte traceTail = 0;
+unsigned int traceDropped = 0;
+#endif
+
+#if SD_STREAMING
+struct StreamBuffer {{
+  long block;  // file block held, -1 when empty
+  byte data[SD_BLOCK_SIZE];
+}};
+StreamBuffer streamBuffers[2];
+byte frontBuffer = 0;
+bool showFileOpen = false;
+long showPointCount = 0;
+byte showPlaybackMode = PLAYBACK_LOOP;
+long showLevelCount[DETAIL_LEVELS];
+
+#if defined(ARDUINO)
+#include <SD.h>
+File showFile;
+
+bool openShowFile() {{
+  if (!SD.begin(SD_CS_PIN)) return false;
+  showFile = SD.open(SD_SHOW_FILE);
+  return showFile;
+}}
+
+bool readShowBlock(long block, byte *data) {{
+  if (!showFile.seek((unsigned long)block * SD_BLOCK_SIZE)) return false;
+  return showFile.read(data, SD_BLOCK_SIZE) > 0;
+}}
+#else
+// Host mock block device: the show file is read from the working directory
+#include <stdio.h>
+FILE *showFile = NULL;
+long showBlockReads = 0;  // for host tests
+long movingBlockReads = 0;  // reads with a stepper short of its target
+
+bool openShowFile() {{
+  showFile = fopen(SD_SHOW_FILE, "rb");
+  return showFile != NULL;
+}}
+
+bool readShowBlock(long block, byte *data) {{
+  showBlockReads++;
+  if (stepperX.distanceToGo() != 0 || stepperY.distanceToGo() != 0) movingBlockReads++;
+  if (fseek(showFile, block * SD_BLOCK_SIZE, SEEK_SET) != 0) return false;
+  return fread(data, 1, SD_BLOCK_SIZE, showFile) > 0;
+}}
+#endif
+#endif
+
+// Multi-phase jump state (microstep switching only)
+#define PHASE_IDLE 0
+#define PHASE_ALIGN 1
+#define PHASE_JUMP 2
+byte motionPhase = PHASE_IDLE;
+long xFinalSteps = 0;
+long yFinalSteps = 0;
 
 void setup() {{
   Serial.begin(9600);
+#if LASER_PWM
+  pinMode(LASER_PWM_PIN, OUTPUT);
+#else
   pinMode(LASER_PIN, OUTPUT);
-  digitalWrite(LASER_PIN, LOW); 
+#endif
+  setLaser(false);
+  pinMode(PATTERN_BUTTON_PIN, INPUT_PULLUP);
+#if BOARD == BOARD_DUAL_CORE
+  EEPROM.begin(EEPROM_SIZE);
+#endif
+  
+#if SD_STREAMING
+  beginShowStream();
+#endif
+  
+#if MICROSTEP_SWITCHING
+  pinMode(MS1_PIN, OUTPUT);
+  pinMode(MS2_PIN, OUTPUT);
+  pinMode(MS3_PIN, OUTPUT);
+  setMicrostepMode(DRAW_MS_PATTERN);
+#endif
   
   // --- SPEED SETTINGS ---
-  stepperX.setMaxSpeed(100);       
-  stepperX.setAcceleration(50);   
+  stepperX.setMaxSpeed(BASE_MAX_SPEED);       
+  stepperX.setAcceleration(BASE_ACCELERATION);   
   stepperX.setCurrentPosition(40); 
   
-  stepperY.setMaxSpeed(100);       
-  stepperY.setAcceleration(50);   
+  stepperY.setMaxSpeed(BASE_MAX_SPEED);       
+  stepperY.setAcceleration(BASE_ACCELERATION);   
   stepperY.setCurrentPosition(40); 
+  startMotion();
+  
+#if SHOW_CUES
+  startCue(0);
+#else
+  selectPattern(0);
+#endif
   
+#if LOG_LEVEL >= LOG_INFO
   Serial.println("System Ready.");
+  Serial.print("Patterns loaded: ");
+  Serial.print(patternCount);
+  Serial.print(patternAvailable(patternCount) ? " + EEPROM" : "");
+  Serial.println(patternAvailable(patternCount + 1) ? " + SD" : "");
   Serial.print("Points loaded: ");
   Serial.println(numAngles);
+#endif
   delay(1000);
+  frameStartMs = millis();
 }}
 
 void loop() {{
-  stepperX.run();
-  stepperY.run();
+#if BOARD == BOARD_AVR
+  serviceMotion();
+#endif
+  serviceDecode();
+}}
 
-  if (stepperX.distanceToGo() == 0 && stepperY.distanceToGo() == 0) {{
-      
-      // Sequence complete check
-      if (currentIndex >= numAngles) {{
-          currentIndex = 0;
-          digitalWrite(LASER_PIN, LOW);
-          delay(2000);
+// Decode side: commands, button, cues and the next point of the pattern
+void serviceDecode() {{
+  if (Serial.available()) {{
+      pollSerial();
+  }}
+#if LOG_LEVEL >= LOG_DEBUG
+  drainTrace();
+#endif
+  
+  // Hold playback while an upload is writing EEPROM
+  if (uploadRemaining > 0) {{
+      return;
+  }}
+  pollButton();
+
+  if (liveMode || motionQueueFull()) {{
+      return;
+  }}
+  
+  // Sequence complete check
+  if (currentIndex >= numAngles || currentIndex < 0) {{
+      frameComplete();
+  }}
+#if SHOW_CUES
+  if (showRunning && cueFinished()) {{
+      startCue((cueIndex + 1) % SHOW_CUES);
+  }}
+#endif
+  
+  if (currentIndex >= 0 && currentIndex < numAngles) {{
+      bool laserOn = laserForMove(lastIndex, currentIndex);
+#if SHOW_CUES
+      if (cueTravel) {{
+          laserOn = false;
+          cueTravel = false;
+      }} else if (showRunning && (long)(millis() - cueStartMs) < 0) {{
+          return;  // parked on the first point until the blank ends
       }}
+#endif
+#if SD_STREAMING && BOARD != BOARD_AVR
+      prefetchShowBlock();
+#endif
       
-      if (currentIndex < numAngles) {{
-          
-          // 1. SET LASER
-          if (laserValues[currentIndex]) {{
-             digitalWrite(LASER_PIN, HIGH);
+      queueMove(xAngleAt(currentIndex), yAngleAt(currentIndex), laserOn);
+      LOG_EVENT(TRACE_MOVE, laserOn, currentIndex);
+      lastIndex = currentIndex;
+      currentIndex = stepIndex(currentIndex);
+  }}
+}}
+
+// Motion side: run the steppers and start the next queued command once
+// both have arrived
+void serviceMotion() {{
+  stepperX.run();
+  stepperY.run();
+  
+#if LASER_PWM
+  updateLaserPower();
+#endif
+
+  if (stepperX.distanceToGo() != 0 || stepperY.distanceToGo() != 0 || !advanceMotion()) {{
+      return;
+  }}
+  if (motionBusy) {{
+      QUEUE_STORE(motionTail, (byte)(motionTail + 1));
+      motionBusy = false;
+  }}
+#if SD_STREAMING && BOARD == BOARD_AVR
+  prefetchShowBlock();  // at rest on a point (see SD STREAMING)
+#endif
+  if (QUEUE_LOAD(motionHead) == motionTail) {{
+      return;
+  }}
+  
+  const MotionCommand &command = motionQueue[motionTail % MOTION_QUEUE_SIZE];
+  motionBusy = true;
+  switch (command.kind) {{
+      case MOTION_MOVE:
+          setLaser(command.laserOn);
+          moveToAngles(command.xAngle, command.yAngle, command.laserOn);
+          delay(5);
+          break;
+      case MOTION_LASER:
+          setLaser(command.laserOn);
+          break;
+      case MOTION_DWELL:
+          setLaser(false);
+          delay(command.dwellMs);
+          break;
+      case MOTION_SPEED:
+          setSpeedScale(command.speedScale);
+          break;
+  }}
+}}
+
+void startMotion() {{
+#if BOARD == BOARD_DUAL_CORE
+  // The motion task never blocks for long, so core 0's idle task would
+  // trip the watchdog; Serial, WiFi and decoding stay on core 1
+  disableCore0WDT();
+  xTaskCreatePinnedToCore(motionTaskMain, "motion", 4096, NULL, 1, &motionTask, MOTION_CORE);
+#elif BOARD == BOARD_HOST
+  pthread_create(&motionThread, NULL, motionThreadMain, NULL);
+#endif
+}}
+
+#if BOARD == BOARD_DUAL_CORE
+void motionTaskMain(void *) {{
+  for (;;) {{
+      serviceMotion();
+  }}
+}}
+#elif BOARD == BOARD_HOST
+void *motionThreadMain(void *) {{
+  for (;;) {{
+      serviceMotion();
+  }}
+  return NULL;
+}}
+#endif
+
+// Gives the motion side a turn while the decode side waits on it
+void waitForMotion() {{
+#if BOARD == BOARD_AVR
+  serviceMotion();
+#elif BOARD == BOARD_DUAL_CORE
+  delay(1);
+#else
+  sched_yield();
+#endif
+}}
+
+bool motionQueueFull() {{
+  return (byte)(motionHead - QUEUE_LOAD(motionTail)) >= MOTION_QUEUE_SIZE;
+}}
+
+bool motionIdle() {{
+  return QUEUE_LOAD(motionTail) == motionHead;
+}}
+
+void waitForMotionIdle() {{
+  while (!motionIdle()) {{
+      waitForMotion();
+  }}
+}}
+
+void pushMotion(byte kind, bool laserOn, byte scale, unsigned int dwellMs, float xAngle, float yAngle) {{
+  // Only the point loop checks for room first, anything else waits here
+  while (motionQueueFull()) {{
+      waitForMotion();
+  }}
+  MotionCommand &command = motionQueue[motionHead % MOTION_QUEUE_SIZE];
+  command.kind = kind;
+  command.laserOn = laserOn;
+  command.speedScale = scale;
+  command.dwellMs = dwellMs;
+  command.xAngle = xAngle;
+  command.yAngle = yAngle;
+  QUEUE_STORE(motionHead, (byte)(motionHead + 1));
+}}
+
+void queueMove(float xAngle, float yAngle, bool laserOn) {{
+  pushMotion(MOTION_MOVE, laserOn, 0, 0, xAngle, yAngle);
+}}
+
+void queueLaser(bool on) {{
+  pushMotion(MOTION_LASER, on, 0, 0, 0, 0);
+}}
+
+void queueDwell(unsigned int ms) {{
+  pushMotion(MOTION_DWELL, false, 0, ms, 0, 0);
+}}
+
+void queueSpeedScale(byte scale) {{
+  speedScale = scale;
+  pushMotion(MOTION_SPEED, false, scale, 0, 0, 0);
+}}
+
+void setLaser(bool on) {{
+  laserEnabled = on;
+#if LASER_PWM
+  analogWrite(LASER_PWM_PIN, on ? laserDuty() : 0);
+  lastPowerUpdateUs = micros();
+#else
+  digitalWrite(LASER_PIN, on ? HIGH : LOW);
+#endif
+}}
+
+#if LASER_PWM
+// Combined speed of both axes in drawing steps per second
+float beamSpeed() {{
+  float speedX = stepperX.speed();
+  float speedY = stepperY.speed();
+  return sqrt(speedX * speedX + speedY * speedY);
+}}
+
+byte laserDuty() {{
+  long duty = (long)(beamSpeed() * 255.0 / LASER_FULL_POWER_SPEED);
+  return constrain(duty, (long)LASER_MIN_DUTY, 255L);
+}}
+
+void updateLaserPower() {{
+  // analogWrite is cheap, but not free enough to run between every step
+  if (!laserEnabled || micros() - lastPowerUpdateUs < LASER_PWM_UPDATE_US) return;
+  lastPowerUpdateUs = micros();
+  analogWrite(LASER_PWM_PIN, laserDuty());
+}}
+#endif
+
+void frameComplete() {{
+  // The frame ends when its last move has played, not when it was queued
+  waitForMotionIdle();
+  LOG_EVENT(TRACE_FRAME, speedScale, millis() - frameStartMs);
+  governFrame();
+#if SHOW_CUES
+  if (cueFrames < 255) cueFrames++;
+#endif
+
+  if (playbackMode == PLAYBACK_PINGPONG && numAngles > 1) {{
+      // Turn around on the end point instead of flying back to the start
+      playDirection = -playDirection;
+      currentIndex = stepIndex(lastIndex);
+      return;
+  }}
+  
+  // WRAP flows from the last point into the first, point 0's laser flag
+  // covering the seam; LOOP blanks and pauses first
+  currentIndex = 0;
+  lastIndex = (playbackMode == PLAYBACK_WRAP) ? numAngles : -1;
+  playDirection = 1;
+  if (playbackMode == PLAYBACK_LOOP) {{
+#if TARGET_FRAME_MS
+      queueLaser(false);
+#else
+      queueDwell(2000);
+#endif
+  }}
+}}
+
+uint16_t recordWord(long index, byte word) {{
+  if (patternSource == SOURCE_EEPROM) {{
+      int address = EEPROM_HEADER + index * 4 + word * 2;
+      return EEPROM.read(address) | ((uint16_t)EEPROM.read(address + 1) << 8);
+  }}
+#if SD_STREAMING
+  if (patternSource == SOURCE_SD) {{
+      const byte *record = streamRecord(index);
+      return record[word * 2] | ((uint16_t)record[word * 2 + 1] << 8);
+  }}
+#endif
+  return pgm_read_word(patternRecords + index * 2 + word);
+}}
+
+float xAngleAt(long index) {{
+  if (patternSource == SOURCE_SHAPE) {{
+      evaluateShape(index);
+      return shapeX / 100.0;
+  }}
+  if (patternSource == SOURCE_CURVE) {{
+      return curveAngleAt(index, 0);
+  }}
+  return recordAngle(recordWord(index, 0), 0);
+}}
+
+float yAngleAt(long index) {{
+  if (patternSource == SOURCE_SHAPE) {{
+      evaluateShape(index);
+      return shapeY / 100.0;
+  }}
+  if (patternSource == SOURCE_CURVE) {{
+      return curveAngleAt(index, 1);
+  }}
+  return recordAngle(recordWord(index, 1), 1);
+}}
+
+bool laserAt(long index) {{
+  // A shape draws every segment; point 0's only has one across a WRAP seam
+  if (patternSource == SOURCE_SHAPE) return index > 0 || playbackMode == PLAYBACK_WRAP;
+  if (patternSource == SOURCE_CURVE) return curveWord(index / curveSamples, 2, 0) & LASER_BIT;
+  return recordWord(index, 0) & LASER_BIT;
+}}
+
+byte levelAt(long index) {{
+  if (patternSource == SOURCE_SHAPE) return shapeLevel(index);
+  if (patternSource == SOURCE_CURVE) return curveLevel(index);
+  return ((recordWord(index, 0) & LEVEL_BIT) ? 1 : 0) | ((recordWord(index, 1) >> 14) << 1);
+}}
+
+// sin() of a phase (65536 = full turn), scaled to +-16384
+int sineQ14(unsigned int phase) {{
+  unsigned int offset = phase & 0x3FFF;
+  if (phase & 0x4000) offset = 0x4000 - offset;
+  byte slot = offset >> 8;
+  int value = pgm_read_word(&sineTable[slot]);
+  if (slot < 64) {{
+      int next = pgm_read_word(&sineTable[slot + 1]);
+      value += ((long)(next - value) * (offset & 0xFF)) >> 8;
+  }}
+  return (phase & 0x8000) ? -value : value;
+}}
+
+int scaleQ14(int radius, int sine) {{
+  return ((long)radius * sine) >> 14;
+}}
+
+// Position of an open shape's point along its length, 32768 at the end
+long shapeFraction(long index) {{
+  return (index << 15) / max(numAngles - 1, 1L);
+}}
+
+void evaluateShape(long index) {{
+  if (index == shapeIndex) return;
+  shapeIndex = index;
+  
+  const Shape &shape = activeShape;
+  unsigned int turn = (unsigned long)index * 65536UL / numAngles;  // closed shapes
+  switch (shape.type) {{
+      case SHAPE_CIRCLE:
+      case SHAPE_ARC: {{
+          unsigned int phase = shape.phase;
+          if (shape.type == SHAPE_CIRCLE) {{
+              phase += turn;
           }} else {{
-             digitalWrite(LASER_PIN, LOW);
+              phase += (shape.sweep * shapeFraction(index)) >> 15;
+          }}
+          shapeX = shape.centerX + scaleQ14(shape.radiusX, sineQ14(phase + 0x4000));
+          shapeY = shape.centerY + scaleQ14(shape.radiusY, sineQ14(phase));
+          break;
+      }}
+      case SHAPE_POLYGON: {{
+          // Straight edges between corners on the circle, 32768 = next corner
+          unsigned long position = (unsigned long)index * shape.freqA;
+          byte corner = position / numAngles;
+          long along = ((position % numAngles) << 15) / numAngles;
+          unsigned int phaseA = shape.phase + (unsigned int)((unsigned long)corner * 65536UL / shape.freqA);
+          unsigned int phaseB = shape.phase + (unsigned int)((unsigned long)(corner + 1) * 65536UL / shape.freqA);
+          int xA = scaleQ14(shape.radiusX, sineQ14(phaseA + 0x4000));
+          int xB = scaleQ14(shape.radiusX, sineQ14(phaseB + 0x4000));
+          int yA = scaleQ14(shape.radiusY, sineQ14(phaseA));
+          int yB = scaleQ14(shape.radiusY, sineQ14(phaseB));
+          shapeX = shape.centerX + xA + (((xB - xA) * along) >> 15);
+          shapeY = shape.centerY + yA + (((yB - yA) * along) >> 15);
+          break;
+      }}
+      case SHAPE_LISSAJOUS:
+          shapeX = shape.centerX + scaleQ14(shape.radiusX, sineQ14(shape.phase + turn * shape.freqA));
+          shapeY = shape.centerY + scaleQ14(shape.radiusY, sineQ14(turn * shape.freqB));
+          break;
+      case SHAPE_SINE: {{
+          long fraction = shapeFraction(index);
+          shapeX = shape.centerX - shape.radiusX + ((2L * shape.radiusX * fraction) >> 15);
+          shapeY = shape.centerY + scaleQ14(shape.radiusY, sineQ14(shape.phase + (unsigned int)(fraction * shape.freqA * 2)));
+          break;
+      }}
+  }}
+}}
+
+// Every 2^k-th sample belongs to level DETAIL_LEVELS - 1 - k, so each
+// coarser level halves the sampling
+byte halvingLevel(long sample) {{
+  byte level = DETAIL_LEVELS - 1;
+  while (level > 0 && (sample & 1) == 0) {{
+      sample >>= 1;
+      level--;
+  }}
+  return level;
+}}
+
+byte shapeLevel(long index) {{
+  if (index == 0 || index == numAngles - 1) return 0;
+  return halvingLevel(index);
+}}
+
+// Element end points are always level 0; jumps only play their end point
+byte curveLevel(long index) {{
+  int sample = index % curveSamples;
+  if (sample == curveSamples - 1) return 0;
+  if (!laserAt(index)) return LEVEL_HIDDEN;
+  return halvingLevel(sample + 1);
+}}
+
+uint16_t curveWord(long element, byte point, byte word) {{
+  return pgm_read_word(patternRecords + element * 6 + point * 2 + word);
+}}
+
+void loadCurveAxis(long *state, long p0, long p1, long p2, long p3) {{
+  long a = -p0 + 3 * p1 - 3 * p2 + p3;
+  long b = 3 * p0 - 6 * p1 + 3 * p2;
+  long c = 3 * (p1 - p0);
+  // 64-bit only while loading, stepping stays in 32 bits
+  int64_t samples = curveSamples;
+  int64_t cube = samples * samples * samples;
+  state[0] = p0 * CURVE_ONE;
+  state[1] = (a + b * samples + c * samples * samples) * CURVE_ONE / cube;
+  state[2] = (6 * a + 2 * b * samples) * CURVE_ONE / cube;
+  state[3] = (int64_t)6 * a * CURVE_ONE / cube;
+}}
+
+void loadCurveElement(long element) {{
+  long previous = (element > 0 ? element : curveElements) - 1;
+  for (byte word = 0; word < 2; word++) {{
+      loadCurveAxis(word == 0 ? curveX : curveY,
+                    curveWord(previous, 2, word) & ANGLE_MASK,
+                    curveWord(element, 0, word) & ANGLE_MASK,
+                    curveWord(element, 1, word) & ANGLE_MASK,
+                    curveWord(element, 2, word) & ANGLE_MASK);
+  }}
+  curveElement = element;
+  curveStep = -1;
+}}
+
+void stepCurveAxis(long *state, int direction) {{
+  if (direction > 0) {{
+      state[0] += state[1];
+      state[1] += state[2];
+      state[2] += state[3];
+  }} else {{
+      // Exact inverse, so ping-pong can run the differences backwards
+      state[2] -= state[3];
+      state[1] -= state[2];
+      state[0] -= state[1];
+  }}
+}}
+
+// Sample k of an element sits at t = (k + 1) / curveSamples. Neighbouring
+// samples cost three additions per axis; entering an element elsewhere
+// replays it from the start.
+float curveAngleAt(long index, byte word) {{
+  long element = index / curveSamples;
+  int sample = index % curveSamples;
+  if (sample == curveSamples - 1 || !(curveWord(element, 2, 0) & LASER_BIT)) {{
+      return recordAngle(curveWord(element, 2, word), word);
+  }}
+  
+  if (element != curveElement) {{
+      loadCurveElement(element);
+  }}
+  int direction = (sample > curveStep) ? 1 : -1;
+  while (curveStep != sample) {{
+      stepCurveAxis(curveX, direction);
+      stepCurveAxis(curveY, direction);
+      curveStep += direction;
+  }}
+  long position = (word == 0) ? curveX[0] : curveY[0];
+#if WALL_SPACE
+  return wallToAngle((position - WALL_OFFSET * CURVE_ONE) / 256, word);
+#else
+  return position / (CURVE_ONE * 100.0);
+#endif
+}}
+
+float recordAngle(uint16_t value, byte axis) {{
+#if WALL_SPACE
+  return wallToAngle(((long)(value & ANGLE_MASK) - WALL_OFFSET) * 256L, axis);
+#else
+  (void)axis;  // both axes store plain angles
+  return (value & ANGLE_MASK) / 100.0;
+#endif
+}}
+
+// atan() in millidegrees of a ratio in Q14 (16384 = 1, i.e. 45 degrees);
+// ratios above 1 use atan(r) = 90 - atan(1 / r)
+long atanMillidegrees(long ratio) {{
+  bool negative = ratio < 0;
+  if (negative) ratio = -ratio;
+  bool inverted = ratio > 16384;
+  if (inverted) ratio = (16384L * 16384L) / ratio;
+  
+  byte slot = ratio >> 8;
+  long value = pgm_read_word(&atanTable[slot]);
+  if (slot < 64) {{
+      long next = pgm_read_word(&atanTable[slot + 1]);
+      value += ((next - value) * (ratio & 0xFF)) >> 8;
+  }}
+  if (inverted) value = 90000L - value;
+  return negative ? -value : value;
+}}
+
+// Wall position in 1/256 half millimetres from the centre to the angle of
+// one axis, for the current wall distance and projection size
+float wallToAngle(long wallQ8, byte axis) {{
+  // ratio = mm * (projectionMm / PROJECTION_MM) / wallDistanceMm, in Q14
+  int64_t ratio = (int64_t)wallQ8 * projectionMm * 32 / ((int64_t)PROJECTION_MM * wallDistanceMm);
+  float degrees = atanMillidegrees((long)ratio) / 1000.0;
+  return (axis == 0) ? 45.0 + degrees : 45.0 - degrees;
+}}
+
+void moveLive(long dx, long dy, bool laserOn) {{
+  if (!liveMode) {{
+      liveMode = true;
+      liveX = liveY = 0;
+      laserOn = false;  // first move is the blanked travel to the centre
+  }}
+  liveX = constrain(liveX + dx, -(long)WALL_OFFSET, (long)WALL_OFFSET - 1);
+  liveY = constrain(liveY + dy, -(long)WALL_OFFSET, (long)WALL_OFFSET - 1);
+  queueMove(wallToAngle(liveX * 256, 0), wallToAngle(liveY * 256, 1), laserOn);
+}}
+
+bool eepromPatternValid() {{
+  return EEPROM.read(0) == EEPROM_MAGIC;
+}}
+
+// Patterns 0..patternCount-1 live in flash, patternCount is the EEPROM
+// slot and patternCount + 1 the show streamed from SD
+bool patternAvailable(byte index) {{
+  if (index < patternCount) return true;
+  if (index == patternCount) return eepromPatternValid();
+#if SD_STREAMING
+  if (index == patternCount + 1) return showFileOpen;
+#endif
+  return false;
+}}
+
+void selectPattern(byte index) {{
+  if (!patternAvailable(index)) return;
+  
+  if (index < patternCount) {{
+      patternSource = SOURCE_FLASH;
+      patternRecords = patterns[index].records;
+      numAngles = patterns[index].count;
+      playbackMode = patterns[index].playbackMode;
+      if (patterns[index].shape != NULL) {{
+          patternSource = SOURCE_SHAPE;
+          memcpy_P(&activeShape, patterns[index].shape, sizeof(Shape));
+          shapeIndex = -1;
+      }} else if (patterns[index].curve) {{
+          patternSource = SOURCE_CURVE;
+          curveElements = patterns[index].count;
+          numAngles = curveElements * curveSamples;
+          curveElement = -1;
+      }}
+  }} else if (index == patternCount) {{
+      patternSource = SOURCE_EEPROM;
+      playbackMode = EEPROM.read(1);
+      numAngles = EEPROM.read(2) | (EEPROM.read(3) << 8);
+  }}
+#if SD_STREAMING
+  else {{
+      patternSource = SOURCE_SD;
+      playbackMode = showPlaybackMode;
+      numAngles = showPointCount;
+  }}
+#endif
+  
+  // Restart the cursor; the beam travels blanked to the new first point
+  currentPattern = index;
+  currentIndex = 0;
+  lastIndex = -1;
+  playDirection = 1;
+  queueLaser(false);
+  LOG_EVENT(TRACE_PATTERN, index, numAngles);
+  
+  for (byte level = 0; level < DETAIL_LEVELS; level++) {{
+      levelPointCount[level] = 0;
+  }}
+#if SD_STREAMING
+  if (patternSource == SOURCE_SD) {{
+      // Counted by the generator, scanning the whole card would take seconds
+      for (byte level = 0; level < DETAIL_LEVELS; level++) {{
+          levelPointCount[level] = showLevelCount[level];
+      }}
+      return;
+  }}
+#endif
+  for (long i = 0; i < numAngles; i++) {{
+      for (byte level = levelAt(i); level < DETAIL_LEVELS; level++) {{
+          levelPointCount[level]++;
+      }}
+  }}
+}}
+
+#if SD_STREAMING
+// Header block: "EELS", version, playback mode, detail levels, reserved,
+// point count, then the point count of all 8 detail levels (little-endian)
+long headerLong(const byte *data) {{
+  return (long)data[0] | ((long)data[1] << 8) | ((long)data[2] << 16) | ((long)data[3] << 24);
+}}
+
+void beginShowStream() {{
+  StreamBuffer &buffer = streamBuffers[0];
+  if (!openShowFile() || !readShowBlock(0, buffer.data)) return;
+  if (memcmp(buffer.data, SD_MAGIC, 4) != 0 || buffer.data[4] != 1) return;
+  if (buffer.data[6] > DETAIL_LEVELS) return;  // needs a finer sketch
+  
+  showPlaybackMode = buffer.data[5];
+  showPointCount = headerLong(buffer.data + 8);
+  for (byte level = 0; level < DETAIL_LEVELS; level++) {{
+      showLevelCount[level] = headerLong(buffer.data + 12 + level * 4);
+  }}
+  streamBuffers[0].block = -1;
+  streamBuffers[1].block = -1;
+  showFileOpen = true;
+}}
+
+byte *loadStreamBlock(byte slot, long block) {{
+  if (streamBuffers[slot].block != block) {{
+      if (!readShowBlock(block, streamBuffers[slot].data)) {{
+          memset(streamBuffers[slot].data, 0, SD_BLOCK_SIZE);  // blanked at 0,0
+      }}
+      streamBuffers[slot].block = block;
+  }}
+  return streamBuffers[slot].data;
+}}
+
+const byte *streamRecord(long index) {{
+  long block = 1 + index / SD_RECORDS_PER_BLOCK;
+  int offset = (index % SD_RECORDS_PER_BLOCK) * 4;
+  
+  if (streamBuffers[frontBuffer].block != block) {{
+      // Normally the prefetch already holds it, otherwise this read stalls
+#if BOARD == BOARD_AVR
+      if (streamBuffers[frontBuffer ^ 1].block != block) {{
+          waitForMotionIdle();  // the read blocks, so not in the middle of a move
+      }}
+#endif
+      frontBuffer ^= 1;
+      if (streamBuffers[frontBuffer].block != block) {{
+          loadStreamBlock(frontBuffer, block);
+      }}
+  }}
+  return streamBuffers[frontBuffer].data + offset;
+}}
+
+// Read the next block in the play direction into the back buffer so the
+// cursor does not wait on the card (see SD STREAMING for when it runs)
+void prefetchShowBlock() {{
+  if (patternSource != SOURCE_SD) return;
+  long current = streamBuffers[frontBuffer].block;
+  long lastBlock = 1 + (numAngles - 1) / SD_RECORDS_PER_BLOCK;
+  long next = current + playDirection;
+  if (next < 1 || next > lastBlock) {{
+      // Ping-pong turns around, everything else wraps to the first block
+      next = (playbackMode == PLAYBACK_PINGPONG) ? current - playDirection : 1;
+      next = constrain(next, 1L, lastBlock);
+  }}
+  if (next != current) {{
+      loadStreamBlock(frontBuffer ^ 1, next);
+  }}
+}}
+#endif
+
+void pollButton() {{
+  bool down = digitalRead(PATTERN_BUTTON_PIN) == LOW;
+  if (down == buttonWasDown || millis() - buttonChangeMs < BUTTON_DEBOUNCE_MS) return;
+  buttonWasDown = down;
+  buttonChangeMs = millis();
+  
+  if (down) {{
+      showRunning = false;
+      liveMode = false;
+      byte next = currentPattern;
+      do {{
+          next = (next + 1) % (patternCount + 2);
+      }} while (!patternAvailable(next));
+      selectPattern(next);
+  }}
+}}
+
+void beginUpload(int count, byte mode) {{
+  int capacity = (EEPROM.length() - EEPROM_HEADER) / 4;
+  if (count <= 0 || count > capacity || mode > PLAYBACK_PINGPONG) {{
+      Serial.println("ERR upload size");
+      return;
+  }}
+  
+  // Invalidate the slot until the checksum has been verified
+  if (patternSource == SOURCE_EEPROM) selectPattern(0);
+  EEPROM_UPDATE(0, 0);
+  EEPROM_COMMIT();
+  queueLaser(false);
+  
+  uploadCount = count;
+  uploadMode = mode;
+  uploadRemaining = (long)count * 4 + 1;
+  uploadAddress = EEPROM_HEADER;
+  uploadChecksum = 0;
+  Serial.write('.');
+}}
+
+void receiveUploadByte(byte value) {{
+  uploadRemaining--;
+  if (uploadRemaining == 0) {{
+      if (value != uploadChecksum) {{
+          Serial.println("ERR checksum");
+          return;
+      }}
+      EEPROM_UPDATE(1, uploadMode);
+      EEPROM_UPDATE(2, uploadCount & 0xFF);
+      EEPROM_UPDATE(3, uploadCount >> 8);
+      EEPROM_UPDATE(0, EEPROM_MAGIC);
+      EEPROM_COMMIT();  // the records and the header in one go
+      Serial.println("OK");
+      return;
+  }}
+  
+  EEPROM_UPDATE(uploadAddress++, value);
+  uploadChecksum ^= value;
+  if ((uploadAddress - EEPROM_HEADER) % UPLOAD_CHUNK == 0) {{
+      Serial.write('.');
+  }}
+}}
+
+// Next point in the play direction that belongs to the current detail
+// level, skipping pointStride - 1 of those but always landing on the end
+// point (level 0) before the frame completes
+long stepIndex(long index) {{
+  long endIndex = (playDirection > 0) ? numAngles - 1 : 0;
+  if (index == endIndex) {{
+      return index + playDirection;
+  }}
+  
+  long next = index;
+  int visible = 0;
+  while (visible < pointStride && next != endIndex) {{
+      next += playDirection;
+      if (levelAt(next) <= detailLevel) visible++;
+  }}
+  return next;
+}}
+
+// A point's laser flag describes the segment from point i-1 to point i. A
+// move that skips points or runs backwards is lit only if every segment it
+// covers is lit; across a WRAP seam point 0's own flag covers it. After a
+// restart the beam comes from the park position or another pattern, so
+// that travel is always blanked, whatever the first point's flag says.
+bool laserForMove(long from, long to) {{
+  if (from < 0) {{
+      return false;
+  }}
+  if (from >= numAngles) {{
+      return laserAt(to);
+  }}
+  long first = min(from, to) + 1;
+  long last = max(from, to);
+  for (long i = first; i <= last; i++) {{
+      if (!laserAt(i)) return false;
+  }}
+  return true;
+}}
+
+void pollSerial() {{
+  while (Serial.available()) {{
+      char c = Serial.read();
+      if (uploadRemaining > 0) {{
+          receiveUploadByte(c);
+          continue;
+      }}
+      if (c == '\\n' || c == '\\r') {{
+          commandBuffer[commandLength] = '\\0';
+          if (commandLength > 0) handleCommand(commandBuffer);
+          commandLength = 0;
+      }} else if (commandLength < sizeof(commandBuffer) - 1) {{
+          commandBuffer[commandLength++] = c;
+      }}
+  }}
+}}
+
+void handleCommand(const char *command) {{
+  if (command[0] == 'L') {{
+      if (command[1] == 'A') {{
+          detailPinned = false;
+      }} else {{
+          detailLevel = constrain(atoi(command + 1), 0, DETAIL_LEVELS - 1);
+          detailPinned = true;
+      }}
+      Serial.print("Detail level: ");
+      Serial.print(detailLevel);
+      Serial.println(detailPinned ? " (pinned)" : " (auto)");
+  }} else if (command[0] == 'P') {{
+      showRunning = false;
+      liveMode = false;
+      selectPattern(atoi(command + 1));
+      Serial.print("Pattern: ");
+      Serial.println(currentPattern);
+  }} else if (command[0] == 'U') {{
+      const char *comma = strchr(command, ',');
+      beginUpload(atoi(command + 1), comma ? atoi(comma + 1) : PLAYBACK_LOOP);
+  }} else if (command[0] == 'C') {{
+      curveSamples = constrain(atoi(command + 1), 1, CURVE_MAX_SAMPLES);
+      if (patternSource == SOURCE_CURVE) selectPattern(currentPattern);
+      Serial.print("Curve samples: ");
+      Serial.println(curveSamples);
+  }} else if (command[0] == 'D' || command[0] == 'S') {{
+      long mm = atol(command + 1);
+      if (mm > 0) {{
+          if (command[0] == 'D') wallDistanceMm = mm; else projectionMm = mm;
+      }}
+      Serial.print("Wall distance: ");
+      Serial.print(wallDistanceMm);
+      Serial.print("mm | Projection size: ");
+      Serial.print(projectionMm);
+      Serial.println("mm");
+  }} else if (command[0] == 'J') {{
+      const char *first = strchr(command, ',');
+      const char *second = first ? strchr(first + 1, ',') : NULL;
+      if (!first) return;
+      moveLive(atol(command + 1), atol(first + 1), second && atoi(second + 1));
+  }} else if (command[0] == 'T') {{
+#if SHOW_CUES
+      liveMode = false;
+      showRunning = true;
+      startCue(0);
+      Serial.println(showRunning ? "Timeline started" : "ERR no playable cue");
+#else
+      Serial.println("ERR no timeline");
+#endif
+  }}
+}}
+
+#if SHOW_CUES
+void startCue(byte index) {{
+  // A cue on an empty EEPROM slot or a missing card is passed over
+  for (byte tries = 0; tries < SHOW_CUES; tries++) {{
+      byte pattern = pgm_read_byte(&cues[index].pattern);
+      if (patternAvailable(pattern)) {{
+          cueIndex = index;
+          cueFrames = 0;
+          selectPattern(pattern);
+          cueTravel = true;
+          cueStartMs = millis() + pgm_read_word(&cues[index].blankMs);
+          LOG_EVENT(TRACE_CUE, index, currentPattern);
+          return;
+      }}
+#if LOG_LEVEL >= LOG_WARN
+      Serial.print("Cue ");
+      Serial.print(index);
+      Serial.print(" skipped, no pattern ");
+      Serial.println(pattern);
+#endif
+      index = (index + 1) % SHOW_CUES;
+  }}
+  showRunning = false;  // nothing in the timeline can play
+}}
+
+bool cueFinished() {{
+  byte frames = pgm_read_byte(&cues[cueIndex].frames);
+  if (frames > 0) {{
+      return cueFrames >= frames;
+  }}
+  return (long)(millis() - cueStartMs) >= (long)pgm_read_word(&cues[cueIndex].durationMs);
+}}
+#endif
+
+void governFrame() {{
+#if TARGET_FRAME_MS
+  unsigned long frameMs = millis() - frameStartMs;
+  unsigned long padMs = 0;
+
+  if (frameMs > TARGET_FRAME_MS) {{
+      // Too slow: speed the motors up first, then drop to a coarser
+      // detail level, and only then start skipping points
+      if (speedScale < MAX_SPEED_SCALE) {{
+          queueSpeedScale(speedScale + 1);
+      }} else if (detailLevel > 0 && !detailPinned) {{
+          detailLevel--;
+      }} else if (pointStride < MAX_POINT_STRIDE) {{
+          pointStride++;
+      }} else {{
+          reportMissedFrame(frameMs);
+      }}
+  }} else {{
+      // Give detail back first, then calm the motors, but only when the
+      // estimated frame time after the change still fits the target
+      if (pointStride > 1) {{
+          if (frameMs * pointStride < (unsigned long)TARGET_FRAME_MS * (pointStride - 1)) {{
+              pointStride--;
+          }}
+      }} else if (detailLevel < DETAIL_LEVELS - 1 && !detailPinned) {{
+          if (frameMs * levelPointCount[detailLevel + 1] <
+              (unsigned long)TARGET_FRAME_MS * levelPointCount[detailLevel]) {{
+              detailLevel++;
+          }}
+      }} else if (speedScale > 1) {{
+          if (frameMs * speedScale < (unsigned long)TARGET_FRAME_MS * (speedScale - 1)) {{
+              queueSpeedScale(speedScale - 1);
           }}
-          
-          // 2. MOVE MOTORS
-          moveToAngles(xAngles[currentIndex], yAngles[currentIndex]);
-          
-          // 3. INCREMENT
-          currentIndex++;
-          
-          // 4. WAIT
-          delay(5); 
       }}
+
+      // Pad the rest of the period with a blanked dwell; it plays on the
+      // motion side, so the next frame starts when it ends
+      padMs = TARGET_FRAME_MS - frameMs;
+      queueDwell(padMs);
+  }}
+
+  frameStartMs = millis() + padMs;
+#else
+  frameStartMs = millis();
+#endif
+}}
+
+void setSpeedScale(byte scale) {{
+  // Short point-to-point moves are acceleration bound, so scale it squared
+  stepperX.setMaxSpeed(BASE_MAX_SPEED * (float)scale);
+  stepperX.setAcceleration(BASE_ACCELERATION * (float)scale * scale);
+  stepperY.setMaxSpeed(BASE_MAX_SPEED * (float)scale);
+  stepperY.setAcceleration(BASE_ACCELERATION * (float)scale * scale);
+}}
+
+void reportMissedFrame(unsigned long frameMs) {{
+  missedFrames++;
+  LOG_EVENT(TRACE_MISSED, 0, frameMs);
+#if LOG_LEVEL >= LOG_WARN
+  // Rate limited so the report itself does not slow the next frames
+  if (millis() - lastReportMs < TELEMETRY_INTERVAL_MS) return;
+  lastReportMs = millis();
+
+  Serial.print("Frame target missed: ");
+  Serial.print(frameMs);
+  Serial.print("ms > ");
+  Serial.print(TARGET_FRAME_MS);
+  Serial.print("ms at full speed and stride, ");
+  Serial.print(missedFrames);
+  Serial.println(" frames so far");
+#endif
+}}
+
+#if LOG_LEVEL >= LOG_DEBUG
+void traceEvent(byte type, byte detail, long value) {{
+  if ((byte)(traceHead - traceTail) >= TRACE_BUFFER_SIZE) {{
+      traceDropped++;
+      return;
   }}
+  TraceEvent &event = traceBuffer[traceHead % TRACE_BUFFER_SIZE];
+  event.type = type;
+  event.detail = detail;
+  event.timeMs = millis();
+  event.value = value;
+  traceHead++;
 }}
 
-void moveToAngles(float targetXData, float targetYData) {{
+void drainTrace() {{
+  // Upload acknowledgements must not have records in between
+  if (uploadRemaining > 0) return;
+  
+  if (traceDropped > 0 && (byte)(traceHead - traceTail) < TRACE_BUFFER_SIZE) {{
+      unsigned int dropped = traceDropped;
+      traceDropped = 0;
+      traceEvent(TRACE_DROPPED, 0, dropped);
+  }}
+  // Whole records only, and only as many as fit without blocking
+  while (traceHead != traceTail && Serial.availableForWrite() >= TRACE_RECORD_BYTES) {{
+      const TraceEvent &event = traceBuffer[traceTail % TRACE_BUFFER_SIZE];
+      byte record[TRACE_RECORD_BYTES] = {{
+          TRACE_SYNC, event.type, event.detail,
+          (byte)event.timeMs, (byte)(event.timeMs >> 8),
+          (byte)event.value, (byte)(event.value >> 8),
+          (byte)(event.value >> 16), (byte)(event.value >> 24)
+      }};
+      Serial.write(record, TRACE_RECORD_BYTES);
+      traceTail++;
+  }}
+}}
+#endif
+
+void moveToAngles(float targetXData, float targetYData, bool laserOn) {{
   // SWAPPED LOGIC (X Data -> Y Stepper)
   // Uses Absolute Positioning
   
   long stepsForStepperX = angleToAbsoluteSteps(targetYData);
-  stepperX.moveTo(stepsForStepperX);
-
   long stepsForStepperY = angleToAbsoluteSteps(targetXData);
+
+#if MICROSTEP_SWITCHING
+  long distX = labs(stepsForStepperX - stepperX.currentPosition());
+  long distY = labs(stepsForStepperY - stepperY.currentPosition());
+
+  if (!laserOn && max(distX, distY) >= JUMP_MIN_STEPS) {{
+      // Walk both axes onto a jump-step boundary first (towards the target),
+      // advanceMotion() then does the coarse jump and the fine settle
+      xFinalSteps = stepsForStepperX;
+      yFinalSteps = stepsForStepperY;
+      stepperX.moveTo(jumpBoundary(stepperX.currentPosition(), xFinalSteps));
+      stepperY.moveTo(jumpBoundary(stepperY.currentPosition(), yFinalSteps));
+      motionPhase = PHASE_ALIGN;
+      return;
+  }}
+#else
+  (void)laserOn;  // every move steps at the drawing resolution
+#endif
+
+  stepperX.moveTo(stepsForStepperX);
   stepperY.moveTo(stepsForStepperY);
 }}
 
+// Called whenever both steppers are idle; starts the next phase of a
+// multi-phase jump and returns true once the whole move is finished
+bool advanceMotion() {{
+#if MICROSTEP_SWITCHING
+  if (motionPhase == PHASE_ALIGN) {{
+      // Both axes sit on a boundary, so dividing the counters is exact
+      setMicrostepMode(JUMP_MS_PATTERN);
+      stepperX.setCurrentPosition(stepperX.currentPosition() / JUMP_STEP_RATIO);
+      stepperY.setCurrentPosition(stepperY.currentPosition() / JUMP_STEP_RATIO);
+      stepperX.moveTo(floorDiv(xFinalSteps + JUMP_STEP_RATIO / 2, JUMP_STEP_RATIO));
+      stepperY.moveTo(floorDiv(yFinalSteps + JUMP_STEP_RATIO / 2, JUMP_STEP_RATIO));
+      motionPhase = PHASE_JUMP;
+      return false;
+  }}
+
+  if (motionPhase == PHASE_JUMP) {{
+      // Back to drawing resolution and settle on the exact target
+      setMicrostepMode(DRAW_MS_PATTERN);
+      stepperX.setCurrentPosition(stepperX.currentPosition() * JUMP_STEP_RATIO);
+      stepperY.setCurrentPosition(stepperY.currentPosition() * JUMP_STEP_RATIO);
+      stepperX.moveTo(xFinalSteps);
+      stepperY.moveTo(yFinalSteps);
+      motionPhase = PHASE_IDLE;
+      return false;
+  }}
+#endif
+  return true;
+}}
+
+#if MICROSTEP_SWITCHING
+void setMicrostepMode(byte pattern) {{
+  digitalWrite(MS1_PIN, (pattern & 1) ? HIGH : LOW);
+  digitalWrite(MS2_PIN, (pattern & 2) ? HIGH : LOW);
+  digitalWrite(MS3_PIN, (pattern & 4) ? HIGH : LOW);
+  delayMicroseconds(2);  // driver setup time before the next STEP edge
+}}
+
+long floorDiv(long a, long b) {{
+  long q = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+  return q;
+}}
+
+// Nearest jump-step boundary from position in the direction of target
+long jumpBoundary(long position, long target) {{
+  if (target >= position) {{
+      return -floorDiv(-position, JUMP_STEP_RATIO) * JUMP_STEP_RATIO;
+  }}
+  return floorDiv(position, JUMP_STEP_RATIO) * JUMP_STEP_RATIO;
+}}
+#endif
+
 long angleToAbsoluteSteps(float angle) {{
+  // Absolute positions only: nothing carries over from the previous point
   float stepsPerDegree = (STEPS_PER_REV * MICROSTEPS) / 360.0;
-  return (long)(angle * stepsPerDegree);
+  return lround(angle * stepsPerDegree);
 }}
 '''
 
 
-def format_float_array(values: List[float]) -> str:
-    """Format list of floats as C++ array initializer"""
-    return "{" + ", ".join(str(v) for v in values) + "}"
+# Shape primitive types (see the sketch's SHAPE PRIMITIVES)
+SHAPE_TYPES = {"circle": 0, "arc": 1, "polygon": 2, "lissajous": 3, "sine": 4}
+CLOSED_SHAPES = ("circle", "polygon", "lissajous")
 
+PLAYBACK_MODES = {"loop": 0, "wrap": 1, "pingpong": 2}
 
-def format_bool_array(values: List[bool]) -> str:
-    """Format list of bools as C++ array initializer"""
-    return "{" + ", ".join("true" if v else "false" for v in values) + "}"
 
+@dataclass
+class PlaybackPlan:
+    """Playback mode and point order chosen for the generated sketch"""
+    mode: str
+    x_angles: List[float]
+    y_angles: List[float]
+    laser_states: List[bool]
+    frame_travel: float
+    flyback_travel: float
 
-def generate_cpp(
+    def summary(self) -> str:
+        return (
+            f"{self.mode}, {self.frame_travel:.1f} deg travel per frame "
+            f"(was {self.flyback_travel:.1f} deg with flyback)"
+        )
+
+
+def _gap(x_angles: List[float], y_angles: List[float], a: int, b: int) -> float:
+    return math.hypot(x_angles[b] - x_angles[a], y_angles[b] - y_angles[a])
+
+
+def plan_playback(
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    mode: str = "auto"
+) -> PlaybackPlan:
+    """
+    Rotate the point cycle so its longest gap becomes the seam, then pick
+    WRAP for closed paths (seam no longer than a lit segment) or PINGPONG
+    for open ones. An explicit mode skips the choice but keeps the rotation.
+    """
+    n = len(x_angles)
+    path_travel = sum(_gap(x_angles, y_angles, i - 1, i) for i in range(1, n))
+    flyback_travel = path_travel + (_gap(x_angles, y_angles, n - 1, 0) if n else 0.0)
+
+    if n < 3 or mode == "loop":
+        return PlaybackPlan(
+            mode="loop" if mode == "auto" else mode,
+            x_angles=list(x_angles),
+            y_angles=list(y_angles),
+            laser_states=list(laser_states),
+            frame_travel=flyback_travel,
+            flyback_travel=flyback_travel
+        )
+
+    # gaps[i] is the move onto point i, gaps[0] being the seam
+    gaps = [_gap(x_angles, y_angles, i - 1, i) for i in range(n)]
+    start = max(range(n), key=lambda i: gaps[i])
+    seam = gaps[start]
+
+    lit_gaps = [gaps[i] for i in range(1, n) if laser_states[i]]
+    max_lit_gap = max(lit_gaps) if lit_gaps else -1.0
+    closed = seam <= max_lit_gap
+    if mode == "auto":
+        mode = "wrap" if closed else "pingpong"
+
+    order = list(range(start, n)) + list(range(start))
+    laser = [laser_states[i] for i in order]
+    # The old first point now ends what used to be the flyback, and the
+    # new first point's state covers the seam
+    laser[(n - start) % n] = gaps[0] <= max_lit_gap
+    laser[0] = closed and mode == "wrap"
+
+    cycle_travel = sum(gaps)
+    return PlaybackPlan(
+        mode=mode,
+        x_angles=[x_angles[i] for i in order],
+        y_angles=[y_angles[i] for i in order],
+        laser_states=laser,
+        frame_travel=cycle_travel - seam if mode == "pingpong" else cycle_travel,
+        flyback_travel=flyback_travel
+    )
+
+
+def laser_for_move(laser_states: List[bool], source: int, target: int) -> bool:
+    """
+    Mirror of the sketch's laserForMove(): source -1 is a restart (always
+    blanked), len(laser_states) the WRAP seam into target
+    """
+    if source < 0:
+        return False
+    if source >= len(laser_states):
+        return laser_states[target]
+    return all(laser_states[min(source, target) + 1:max(source, target) + 1])
+
+
+def playback_moves(plan: PlaybackPlan, frames: int = 2) -> List[Tuple[int, bool]]:
+    """
+    (point, laser) of every move the sketch plays for plan over frames
+    frames from selectPattern(), at full detail and stride 1
+    """
+    n = len(plan.x_angles)
+    moves: List[Tuple[int, bool]] = []
+    current, last, direction = 0, -1, 1
+    for _ in range(frames):
+        while 0 <= current < n:
+            moves.append((current, laser_for_move(plan.laser_states, last, current)))
+            last, current = current, current + direction
+        # frameComplete()
+        if plan.mode == "pingpong" and n > 1:
+            direction = -direction
+            current = last + direction
+        else:
+            current, last, direction = 0, (n if plan.mode == "wrap" else -1), 1
+    return moves
+
+
+def format_word_array(values: List[int]) -> str:
+    """Format list of 16-bit words as C++ array initializer"""
+    return "{" + ", ".join(f"0x{v:04X}" for v in values) + "}"
+
+
+def angle_to_wall_mm(angle: float, axis: int, wall_distance: float) -> float:
+    """Inverse of convert_to_angles() for one axis: mm from the centre, y down"""
+    offset = angle - 45.0 if axis == 0 else 45.0 - angle
+    return math.tan(math.radians(offset)) * wall_distance * 1000.0
+
+
+def encode_records(
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    levels: List[int],
+    wall_distance: Optional[float] = None
+) -> List[int]:
+    """
+    Pack each point into the sketch's two-word record: 14-bit hundredths of
+    a degree per axis, laser flag and level bit 0 on top of the X word,
+    level bits 1-2 on top of the Y word. With wall_distance (meters) the
+    14 bits hold the WALL_SPACE position instead.
+    """
+    records = []
+    for x, y, on, level in zip(x_angles, y_angles, laser_states, levels):
+        if wall_distance is None:
+            xq, yq = round(x * 100), round(y * 100)
+        else:
+            xq = round(angle_to_wall_mm(x, 0, wall_distance) * WALL_UNITS_PER_MM) + WALL_OFFSET
+            yq = round(angle_to_wall_mm(y, 1, wall_distance) * WALL_UNITS_PER_MM) + WALL_OFFSET
+        if not (0 <= xq <= ANGLE_MASK and 0 <= yq <= ANGLE_MASK):
+            if wall_distance is not None:
+                raise ValueError(f"Angle ({x}, {y}) is more than 4m from the centre on the wall")
+            raise ValueError(f"Angle ({x}, {y}) outside the 0-163.83 degree record range")
+        records.append(xq | (int(bool(on)) << 14) | ((level & 1) << 15))
+        records.append(yq | ((level >> 1) << 14))
+    return records
+
+
+def _triangle_area(x: List[float], y: List[float], a: int, b: int, c: int) -> float:
+    return abs((x[b] - x[a]) * (y[c] - y[a]) - (x[c] - x[a]) * (y[b] - y[a])) / 2.0
+
+
+def assign_detail_levels(
     x_angles: List[float],
     y_angles: List[float],
     laser_states: List[bool],
+    levels: int
+) -> List[int]:
+    """
+    Give every point the coarsest detail level it appears in. Points are
+    ranked by Visvalingam elimination (smallest effective triangle first),
+    stroke ends are pinned to level 0, and each coarser level keeps roughly
+    half the points of the next finer one, so levels nest and share storage.
+    """
+    n = len(x_angles)
+    if levels <= 1 or n < 3:
+        return [0] * n
+
+    # Stroke starts (blanked move onto them) and ends stay at every level
+    pinned = [
+        i == 0 or i == n - 1 or not laser_states[i] or not laser_states[i + 1]
+        for i in range(n)
+    ]
+
+    prev = list(range(-1, n - 1))
+    nxt = list(range(1, n + 1))
+    area = [0.0] * n
+    heap = []
+    for i in range(1, n - 1):
+        if not pinned[i]:
+            area[i] = _triangle_area(x_angles, y_angles, prev[i], i, nxt[i])
+            heapq.heappush(heap, (area[i], i))
+
+    removal_order = []
+    removed = [False] * n
+    while heap:
+        a, i = heapq.heappop(heap)
+        if removed[i] or a != area[i]:
+            continue
+        removed[i] = True
+        removal_order.append(i)
+        p, q = prev[i], nxt[i]
+        nxt[p], prev[q] = q, p
+        for j in (p, q):
+            if not pinned[j]:
+                # Never let a neighbour become cheaper than the point just removed
+                area[j] = max(a, _triangle_area(x_angles, y_angles, prev[j], j, nxt[j]))
+                heapq.heappush(heap, (area[j], j))
+
+    # Earliest removed points only show up at the finest levels
+    result = [0] * n
+    position = 0
+    for level in range(levels - 1, 0, -1):
+        coarser_count = math.ceil(n / (2 ** (levels - level)))
+        dropped = removal_order[position:max(position, n - coarser_count)]
+        for i in dropped:
+            result[i] = level
+        position += len(dropped)
+    return result
+
+
+def _player_steps(angles: List[float], steps_per_degree: float) -> List[int]:
+    """Mirror of the sketch's angleToAbsoluteSteps(): lround() of the exact target"""
+    return [int(math.copysign(math.floor(abs(a * steps_per_degree) + 0.5), a)) for a in angles]
+
+
+def step_resolution(
+    x_angles: List[float],
+    y_angles: List[float],
+    wall_distance: float,
+    steps_per_rev: int = STEPS_PER_REV,
+    microsteps: float = MICROSTEPS
+) -> StepResolution:
+    """Report how finely the player can actually resolve the given angles"""
+    steps_per_degree = (steps_per_rev * microsteps) / 360.0
+    degrees_per_step = 1.0 / steps_per_degree
+    wall_mm = wall_distance * math.tan(math.radians(degrees_per_step)) * 1000.0
+
+    truncated_error = rounded_error = 0.0
+    for angles in (x_angles, y_angles):
+        exact = [a * steps_per_degree for a in angles]
+        truncated_error = max([truncated_error] + [abs(int(e) - e) for e in exact])
+        landed = _player_steps(angles, steps_per_degree)
+        rounded_error = max([rounded_error] + [abs(l - e) for l, e in zip(landed, exact)])
+    # Points closer together than a step are drawn as one
+    points = set(zip(x_angles, y_angles))
+    xs, ys = zip(*points) if points else ((), ())
+    steps = set(zip(_player_steps(list(xs), steps_per_degree), _player_steps(list(ys), steps_per_degree)))
+
+    return StepResolution(
+        steps_per_degree=steps_per_degree,
+        degrees_per_step=degrees_per_step,
+        wall_mm_per_step=wall_mm,
+        truncated_error=truncated_error,
+        rounded_error=rounded_error,
+        collapsed=len(points) - len(steps),
+        point_count=len(x_angles)
+    )
+
+
+def _c_div(a: int, b: int) -> int:
+    """C's integer division, truncating towards zero"""
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def _floor_div(a: int, b: int) -> int:
+    """The sketch's floorDiv()"""
+    q = _c_div(a, b)
+    if a % b != 0 and (a < 0) != (b < 0):
+        q -= 1
+    return q
+
+
+def _jump_boundary(position: int, target: int, ratio: int) -> int:
+    """The sketch's jumpBoundary()"""
+    if target >= position:
+        return -_floor_div(-position, ratio) * ratio
+    return _floor_div(position, ratio) * ratio
+
+
+def simulate_microstep_switching(
+    plan: PlaybackPlan,
+    steps_per_degree: float,
+    jump_step_ratio: int,
+    jump_min_steps: int,
+    driver_ratio: Optional[float] = None,
+    frames: int = 2
+) -> MicrostepPlan:
+    """
+    Replay the moves the sketch plays for plan (see playback_moves) on each
+    axis as step pulses and account for where the mirror physically is, in
+    drawing microsteps, apart from the AccelStepper counter: a pulse moves
+    it one drawing step, or driver_ratio of them while the driver is in
+    jump mode (by default the ratio the sketch assumes). Raises ValueError
+    when the driver switches modes off a whole jump step, when a rescaled
+    counter no longer matches the physical position, or when a move does
+    not end on its target.
+    """
+    if driver_ratio is None:
+        driver_ratio = jump_step_ratio
+    counters = [HOME_STEPS, HOME_STEPS]
+    physical = [HOME_STEPS, HOME_STEPS]
+    jump_count = draw_pulses = jump_pulses = 0
+
+    def run(axis: int, target: int, unit: float) -> int:
+        """Pulse one axis's counter to target, each pulse moving the mirror by unit"""
+        pulses = abs(target - counters[axis])
+        physical[axis] += (target - counters[axis]) * unit
+        counters[axis] = target
+        return pulses
+
+    def rescale(axis: int, counter: int, unit: float, where: str) -> None:
+        counters[axis] = counter
+        if counter * unit != physical[axis]:
+            raise ValueError(
+                f"Axis {axis} {where}: counter {counter} x {unit} "
+                f"but the mirror is at {physical[axis]} drawing steps"
+            )
+
+    # The sketch swaps the axes: stepperX follows the Y angles
+    x_steps = _player_steps(plan.y_angles, steps_per_degree)
+    y_steps = _player_steps(plan.x_angles, steps_per_degree)
+    for index, laser_on in playback_moves(plan, frames):
+        targets = (x_steps[index], y_steps[index])
+        distances = [abs(t - c) for t, c in zip(targets, counters)]
+        draw_pulses += sum(distances)
+
+        if laser_on or max(distances) < jump_min_steps:
+            jump_pulses += sum(run(axis, target, 1) for axis, target in enumerate(targets))
+            continue
+
+        jump_count += 1
+        for axis, target in enumerate(targets):
+            # Drawing mode onto a boundary, jump mode, then drawing mode again
+            jump_pulses += run(axis, _jump_boundary(counters[axis], target, jump_step_ratio), 1)
+            if physical[axis] % driver_ratio != 0:
+                raise ValueError(f"Axis {axis} switched to jump mode off a jump step at {physical[axis]}")
+            rescale(axis, _c_div(counters[axis], jump_step_ratio), driver_ratio, "entering jump mode")
+            jump_pulses += run(axis, _floor_div(target + jump_step_ratio // 2, jump_step_ratio), driver_ratio)
+            rescale(axis, counters[axis] * jump_step_ratio, 1, "leaving jump mode")
+            jump_pulses += run(axis, target, 1)
+
+            if physical[axis] != target:
+                raise ValueError(f"Axis {axis} ended {physical[axis] - target} drawing steps off target")
+
+    return MicrostepPlan(
+        jump_count=jump_count,
+        draw_pulses=draw_pulses,
+        jump_pulses=jump_pulses,
+        frames=frames
+    )
+
+
+def _prepare_pattern(
+    pattern: Pattern,
+    wall_distance: float,
+    steps_per_rev: int,
+    microsteps: float,
+    switching: Optional[Tuple[int, int, str, float]],
+    playback: str,
+    detail_levels: int,
+    curve_tolerance: Optional[float] = None,
+    wall_space: bool = False
+) -> PreparedPattern:
+    """Run one pattern through playback planning, detail levels and checks"""
+    if not pattern.x_angles:
+        raise ValueError(f"Pattern '{pattern.name}' has no points")
+    if not len(pattern.x_angles) == len(pattern.y_angles) == len(pattern.laser_states):
+        raise ValueError(f"Pattern '{pattern.name}' has angle and laser lists of different lengths")
+    plan = plan_playback(pattern.x_angles, pattern.y_angles, pattern.laser_states, playback)
+    resolution = step_resolution(
+        plan.x_angles, plan.y_angles, wall_distance, steps_per_rev, microsteps
+    )
+    
+    if curve_tolerance is not None:
+        elements = fit_curve_path(plan.x_angles, plan.y_angles, plan.laser_states, curve_tolerance)
+        records = encode_curve_elements(elements, wall_distance if wall_space else None)
+        comments = [
+            f"Pattern '{pattern.name}': {len(elements)} curve elements ({len(records)} words) "
+            f"for {len(plan.x_angles)} points ({2 * len(plan.x_angles)} words), "
+            f"within {curve_tolerance} deg",
+        ]
+    else:
+        levels = assign_detail_levels(plan.x_angles, plan.y_angles, plan.laser_states, detail_levels)
+        records = encode_records(
+            plan.x_angles, plan.y_angles, plan.laser_states, levels,
+            wall_distance if wall_space else None
+        )
+        level_counts = [sum(1 for lv in levels if lv <= level) for level in range(detail_levels)]
+        comments = [f"Pattern '{pattern.name}': {len(records) // 2} points"]
+    
+    comments += [
+        f"Resolution: {resolution.summary()}",
+        f"Playback: {plan.summary()}",
+    ]
+    if curve_tolerance is None:
+        comments.append("Detail levels: " + "/".join(str(c) for c in level_counts) + " points")
+    
+    if switching:
+        jump_step_ratio, jump_min_steps, label, driver_ratio = switching
+        steps_per_degree = (steps_per_rev * microsteps) / 360.0
+        microstep_plan = simulate_microstep_switching(
+            plan, steps_per_degree, jump_step_ratio, jump_min_steps, driver_ratio
+        )
+        comments.append(f"Microstep switching: {label} | {microstep_plan.summary()}")
+    
+    return PreparedPattern(
+        name=pattern.name,
+        records=records,
+        playback_mode=PLAYBACK_MODES[plan.mode],
+        comments=comments,
+        curve=curve_tolerance is not None
+    )
+
+
+def encode_curve_elements(
+    elements: List[CurveElement],
+    wall_distance: Optional[float] = None
+) -> List[int]:
+    """Three records per element (control 1, control 2, end), laser flag on the end"""
+    records = []
+    for element in elements:
+        points = [element.control1, element.control2, element.end]
+        records += encode_records(
+            [p[0] for p in points], [p[1] for p in points],
+            [False, False, element.lit], [0, 0, 0], wall_distance
+        )
+    return records
+
+
+def shape_points(shape: Shape) -> Tuple[List[float], List[float]]:
+    """Host-side reference of the sketch's evaluateShape(), in degrees"""
+    if shape.kind not in SHAPE_TYPES:
+        raise ValueError(f"Unknown shape '{shape.kind}', expected one of {list(SHAPE_TYPES)}")
+    
+    n = shape.points
+    start = math.radians(shape.start_deg)
+    xs, ys = [], []
+    for i in range(n):
+        turn = 2 * math.pi * i / n
+        fraction = i / max(n - 1, 1)
+        if shape.kind in ("circle", "arc"):
+            phase = start + (turn if shape.kind == "circle" else math.radians(shape.sweep_deg) * fraction)
+            x, y = math.cos(phase), math.sin(phase)
+        elif shape.kind == "polygon":
+            position = i * shape.freq_a / n
+            corner, along = int(position), position - int(position)
+            a = start + 2 * math.pi * corner / shape.freq_a
+            b = start + 2 * math.pi * (corner + 1) / shape.freq_a
+            x = math.cos(a) + (math.cos(b) - math.cos(a)) * along
+            y = math.sin(a) + (math.sin(b) - math.sin(a)) * along
+        elif shape.kind == "lissajous":
+            x, y = math.sin(start + turn * shape.freq_a), math.sin(turn * shape.freq_b)
+        else:
+            x = 2 * fraction - 1
+            y = math.sin(start + 2 * math.pi * shape.freq_a * fraction)
+        xs.append(shape.center_x + shape.radius_x * x)
+        ys.append(shape.center_y + shape.radius_y * y)
+    return xs, ys
+
+
+def shape_plan(shape: Shape) -> PlaybackPlan:
+    """
+    Points, laser flags and playback mode the sketch gives a shape, for
+    playback_moves(): closed shapes WRAP with point 0's flag covering the
+    seam, open ones PINGPONG with nothing before point 0 to draw
+    """
+    xs, ys = shape_points(shape)
+    closed = shape.kind in CLOSED_SHAPES
+    path_travel = sum(_gap(xs, ys, i - 1, i) for i in range(1, len(xs)))
+    cycle_travel = path_travel + _gap(xs, ys, -1, 0)
+    return PlaybackPlan(
+        mode="wrap" if closed else "pingpong",
+        x_angles=xs,
+        y_angles=ys,
+        laser_states=[closed or i > 0 for i in range(len(xs))],
+        frame_travel=cycle_travel if closed else path_travel,
+        flyback_travel=cycle_travel
+    )
+
+
+def _prepare_shape(
+    index: int,
+    shape: Shape,
+    wall_distance: float,
+    steps_per_rev: int,
+    microsteps: float
+) -> Tuple[PreparedPattern, str]:
+    """Check a shape primitive and build its PROGMEM initializer"""
+    closed = shape.kind in CLOSED_SHAPES
+    if not (3 if closed else 2) <= shape.points <= 0xFFFF:
+        raise ValueError(f"Shape '{shape.name}' needs between {3 if closed else 2} and 65535 points")
+    if shape.kind == "polygon" and not 3 <= shape.freq_a <= 255:
+        raise ValueError(f"Polygon '{shape.name}' needs between 3 and 255 sides")
+    if not (0 <= shape.freq_a <= 255 and 0 <= shape.freq_b <= 255):
+        raise ValueError(f"Shape '{shape.name}' frequencies must be between 0 and 255")
+    
+    plan = shape_plan(shape)
+    xs, ys = plan.x_angles, plan.y_angles
+    if min(xs + ys) < 0 or max(xs + ys) > ANGLE_MASK / 100:
+        raise ValueError(f"Shape '{shape.name}' leaves the 0-163.83 degree range")
+    
+    phase = round(shape.start_deg / 360 * 65536) & 0xFFFF
+    sweep = max(-0xFFFF, min(0xFFFF, round(shape.sweep_deg / 360 * 65536)))
+    fields = [
+        f"SHAPE_{shape.kind.upper()}",
+        round(shape.center_x * 100), round(shape.center_y * 100),
+        round(shape.radius_x * 100), round(shape.radius_y * 100),
+        phase, f"{sweep}L", shape.freq_a, shape.freq_b
+    ]
+    initializer = f"const Shape shape{index} PROGMEM = {{{', '.join(str(f) for f in fields)}}};"
+    
+    resolution = step_resolution(xs, ys, wall_distance, steps_per_rev, microsteps)
+    prepared = PreparedPattern(
+        name=shape.name,
+        records=[],
+        playback_mode=PLAYBACK_MODES[plan.mode],
+        comments=[
+            f"Shape '{shape.name}': {shape.kind}, {shape.points} points evaluated on the player",
+            f"Playback: {plan.summary()}",
+            f"Resolution: {resolution.summary()}",
+        ],
+        shape=shape
+    )
+    return prepared, initializer
+
+
+def generate_bank_cpp(
+    patterns: List[Union[Pattern, Shape]],
     wall_distance: float,
-    projection_size: float
+    projection_size: float,
+    steps_per_rev: int = STEPS_PER_REV,
+    microsteps: float = MICROSTEPS,
+    jump_microsteps: Optional[int] = None,
+    driver: str = "a4988",
+    jump_min_steps: Optional[int] = None,
+    playback: str = "auto",
+    target_frame_ms: int = 0,
+    detail_levels: int = 1,
+    laser_pwm: bool = False,
+    laser_full_power_speed: float = 100.0,
+    sd_streaming: bool = False,
+    timeline: Optional[List[Cue]] = None,
+    curve_tolerance: Optional[float] = None,
+    curve_samples: int = 16,
+    wall_space: bool = False,
+    log_level: str = "info"
 ) -> str:
-    """Generate complete C++ code with embedded data"""
+    """
+    Generate complete C++ code with a bank of patterns in flash.
+    Shape entries are stored as parameters and evaluated by the player.
+    Passing jump_microsteps enables MS1-MS3 switching for blanked jumps.
+    playback is "auto", "loop", "wrap" or "pingpong" (see plan_playback).
+    target_frame_ms > 0 enables the frame governor.
+    detail_levels (1-8) nests coarser subsets of the points for runtime selection.
+    laser_pwm scales laser power with beam speed (full at laser_full_power_speed steps/s).
+    sd_streaming adds the SD card show (see show_file.py) after the flash patterns.
+    timeline is a list of Cue steps played in a loop instead of pattern 0 alone.
+    curve_tolerance (degrees) stores point patterns as fitted cubic Beziers,
+    sampled curve_samples (1-64) times per element by the player.
+    wall_space stores wall positions that the player converts to angles.
+    log_level ("off", "warn", "info" or "debug") picks the Serial diagnostics
+    compiled in; "debug" adds binary trace events (see parse_trace).
+    """
+    
+    if not patterns:
+        raise ValueError("At least one pattern is required")
+    if len(patterns) > MAX_PATTERNS:
+        raise ValueError(f"At most {MAX_PATTERNS} patterns fit the bank with the EEPROM and SD slots")
+    if timeline and len(timeline) > 255:
+        raise ValueError("At most 255 cues fit the timeline")
+    if not 1 <= detail_levels <= 8:
+        raise ValueError("detail_levels must be between 1 and 8")
+    if not 1 <= curve_samples <= 64:
+        raise ValueError("curve_samples must be between 1 and 64")
+    if log_level not in LOG_LEVELS:
+        raise ValueError(f"log_level must be one of {', '.join(LOG_LEVELS)}")
+    
+    switching = None
+    draw_pattern = jump_pattern = 0
+    jump_step_ratio = 1
+    if jump_microsteps is not None:
+        ms_patterns = MS_PATTERNS[driver]
+        if microsteps not in ms_patterns or jump_microsteps not in ms_patterns:
+            raise ValueError(f"{driver} supports microsteps {sorted(ms_patterns)}")
+        if microsteps <= jump_microsteps:
+            raise ValueError("Jump mode must be coarser than drawing mode")
+        draw_pattern = ms_patterns[microsteps]
+        jump_pattern = ms_patterns[jump_microsteps]
+        jump_step_ratio = int(microsteps // jump_microsteps)
+        if jump_min_steps is None:
+            jump_min_steps = 4 * jump_step_ratio
+        switching = (
+            jump_step_ratio, jump_min_steps, f"{microsteps}x draw / {jump_microsteps}x jump",
+            microsteps / jump_microsteps
+        )
+    
+    pattern_data = []
+    pattern_table = []
+    prepared = []
+    for index, pattern in enumerate(patterns):
+        if isinstance(pattern, Shape):
+            entry, data = _prepare_shape(index, pattern, wall_distance, steps_per_rev, microsteps)
+            source = f"NULL, {entry.table_count}"
+            shape = f"&shape{index}"
+        else:
+            entry = _prepare_pattern(
+                pattern, wall_distance, steps_per_rev, microsteps,
+                switching, playback, detail_levels, curve_tolerance, wall_space
+            )
+            data = f"const uint16_t pattern{index}[] PROGMEM = {format_word_array(entry.records)};"
+            source = f"pattern{index}, {entry.table_count}"
+            shape = "NULL"
+        prepared.append(entry)
+        
+        pattern_data.append("")
+        pattern_data.extend(f"// {line}" for line in entry.comments)
+        pattern_data.append(data)
+        mode_name = [name for name, value in PLAYBACK_MODES.items() if value == entry.playback_mode][0]
+        pattern_table.append(
+            f"  {{{source}, PLAYBACK_{mode_name.upper()}, {shape}, {str(entry.curve).lower()}}},  // {entry.name}"
+        )
+    
+    timeline = timeline or []
+    cue_table = []
+    for cue in timeline:
+        if not 0 <= cue.pattern < len(prepared) + 2:
+            raise ValueError(f"Cue pattern {cue.pattern} is not in the bank")
+        if not 0 <= cue.frames <= 255:
+            raise ValueError("Cue frames must be between 0 and 255")
+        if not (0 <= cue.duration_ms <= 0xFFFF and 0 <= cue.blank_ms <= 0xFFFF):
+            raise ValueError("Cue durations must be between 0 and 65535 ms")
+        if cue.frames == 0 and cue.duration_ms == 0:
+            raise ValueError("A cue needs a frame count or a duration")
+        cue_table.append(
+            f"  {{{cue.pattern}, {cue.frames}, {cue.duration_ms}, {cue.blank_ms}}},"
+        )
+    if cue_table:
+        cue_table = ["const Cue cues[SHOW_CUES] PROGMEM = {"] + cue_table + ["};"]
     
     return CPP_TEMPLATE.format(
-        point_count=len(x_angles),
+        pattern_count=len(prepared),
+        point_count=sum(
+            entry.table_count * (curve_samples if entry.curve else 1) for entry in prepared
+        ),
         wall_distance=wall_distance,
         projection_size=projection_size,
-        x_angles=format_float_array(x_angles),
-        y_angles=format_float_array(y_angles),
-        laser_values=format_bool_array(laser_states)
+        steps_per_rev=steps_per_rev,
+        microsteps=microsteps,
+        microstep_switching=int(switching is not None),
+        draw_ms_pattern=f"0b{draw_pattern:03b}",
+        jump_ms_pattern=f"0b{jump_pattern:03b}",
+        jump_step_ratio=jump_step_ratio,
+        jump_min_steps=jump_min_steps or 0,
+        target_frame_ms=int(target_frame_ms),
+        detail_levels=detail_levels,
+        laser_pwm=int(laser_pwm),
+        laser_full_power_speed=laser_full_power_speed,
+        sd_streaming=int(sd_streaming),
+        curve_samples=curve_samples,
+        wall_space=int(wall_space),
+        wall_distance_mm=round(wall_distance * 1000),
+        projection_mm=round(projection_size * 1000),
+        log_level=LOG_LEVELS[log_level],
+        cue_count=len(timeline),
+        cue_table="\n".join(cue_table),
+        pattern_data="\n".join(pattern_data),
+        pattern_table="\n".join(pattern_table)
+    )
+
+
+def generate_cpp(
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    wall_distance: float,
+    projection_size: float,
+    **options
+) -> str:
+    """Generate complete C++ code for a single image, options as for generate_bank_cpp()"""
+    return generate_bank_cpp(
+        [Pattern("image", x_angles, y_angles, laser_states)],
+        wall_distance, projection_size, **options
+    )
+
+
+def pattern_upload_bytes(
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    playback: str = "auto",
+    detail_levels: int = 1,
+    wall_distance: Optional[float] = None
+) -> Tuple[bytes, bytes]:
+    """
+    Build the "U<count>,<mode>" command and the record payload (little-endian
+    words followed by an XOR checksum) for the sketch's EEPROM slot.
+    Pass wall_distance (meters) when the sketch was built with wall_space.
+    """
+    plan = plan_playback(x_angles, y_angles, laser_states, playback)
+    levels = assign_detail_levels(plan.x_angles, plan.y_angles, plan.laser_states, detail_levels)
+    records = encode_records(plan.x_angles, plan.y_angles, plan.laser_states, levels, wall_distance)
+    
+    payload = bytearray()
+    for word in records:
+        payload += bytes((word & 0xFF, word >> 8))
+    checksum = 0
+    for value in payload:
+        checksum ^= value
+    payload.append(checksum)
+    
+    command = f"U{len(records) // 2},{PLAYBACK_MODES[plan.mode]}\n".encode()
+    return command, bytes(payload)
+
+
+def upload_pattern(
+    port: str,
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    playback: str = "auto",
+    detail_levels: int = 1,
+    baud: int = 9600,
+    wall_distance: Optional[float] = None
+) -> None:
+    """Send a pattern into the running sketch's EEPROM slot over Serial"""
+    import serial  # pyserial, only needed for uploads
+    
+    command, payload = pattern_upload_bytes(
+        x_angles, y_angles, laser_states, playback, detail_levels, wall_distance
+    )
+    with serial.Serial(port, baud, timeout=5) as link:
+        link.reset_input_buffer()
+        link.write(command)
+        if _read_upload_ack(link) != b".":
+            raise IOError("Sketch did not accept the upload")
+        
+        data, checksum = payload[:-1], payload[-1:]
+        for start in range(0, len(data), UPLOAD_CHUNK):
+            chunk = data[start:start + UPLOAD_CHUNK]
+            link.write(chunk)
+            # Each full chunk is acknowledged once it is in EEPROM
+            if len(chunk) == UPLOAD_CHUNK and link.read(1) != b".":
+                raise IOError(f"Upload stalled at byte {start}")
+        link.write(checksum)
+        
+        reply = link.readline().strip()
+        if reply != b"OK":
+            raise IOError(f"Upload failed: {reply.decode(errors='replace')}")
+
+
+def _read_upload_ack(link) -> bytes:
+    """First reply byte to an upload command, skipping trace records still in flight"""
+    while True:
+        reply = link.read(1)
+        if reply != bytes((TRACE_SYNC,)):
+            return reply
+        link.read(TRACE_RECORD.size)
+
+
+def parse_trace(data: bytes) -> Tuple[List[TraceEvent], str, bytes]:
+    """
+    Split Serial output of a debug sketch into trace events and the text
+    around them. Returns the events, the text and an incomplete trailing
+    record to put in front of the next read.
+    """
+    events = []
+    text = bytearray()
+    i = 0
+    while i < len(data):
+        if data[i] != TRACE_SYNC:
+            text.append(data[i])
+            i += 1
+            continue
+        if i + 1 + TRACE_RECORD.size > len(data):
+            break
+        kind, detail, time_ms, value = TRACE_RECORD.unpack_from(data, i + 1)
+        events.append(TraceEvent(TRACE_TYPES.get(kind, str(kind)), detail, time_ms, value))
+        i += 1 + TRACE_RECORD.size
+    return events, text.decode(errors="replace"), bytes(data[i:])
+
+
+def animation_cues(holds: List[Tuple[int, int]]) -> List[Cue]:
+    """
+    Timeline of an animation from (pattern, frames to hold it) steps: one
+    cue per step, counted in complete frames so no drawing is cut off, split
+    where a hold is longer than a cue can count
+    """
+    cues = []
+    for pattern, frames in holds:
+        if frames < 1:
+            raise ValueError("Each animation frame must be held for at least one frame")
+        while frames > 0:
+            cues.append(Cue(pattern, frames=min(frames, 255)))
+            frames -= 255
+    return cues
+
+
+def generate_animation_cpp(
+    frames: List[Pattern],
+    holds: List[Tuple[int, int]],
+    wall_distance: float,
+    projection_size: float,
+    **options
+) -> str:
+    """
+    Generate complete C++ code that plays frames as an animation on the
+    timeline: holds lists (frame index, frames to draw it) in playing order,
+    so repeated frames are stored once. options as for generate_bank_cpp().
+    """
+    return generate_bank_cpp(
+        frames, wall_distance, projection_size,
+        timeline=animation_cues(holds), **options
     )
 
 
@@ -147,17 +2514,17 @@ def save_cpp_file(
     y_angles: List[float],
     laser_states: List[bool],
     wall_distance: float,
-    projection_size: float
+    projection_size: float,
+    **options
 ) -> str:
-    """Generate and save C++ file, returns the path"""
+    """Generate and save C++ file, returns the path. options go to generate_cpp()"""
     
     cpp_code = generate_cpp(
         x_angles, y_angles, laser_states,
-        wall_distance, projection_size
+        wall_distance, projection_size, **options
     )
     
     path = Path(output_path)
     path.write_text(cpp_code)
     
     return str(path.absolute())
-
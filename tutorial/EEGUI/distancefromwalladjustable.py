@@ -2,6 +2,7 @@ import cv2
 import numpy as np
 import math
 from scipy.interpolate import splprep, splev
+from spatial_index import PointGrid
 
 # --- CONFIGURATION ---
 INPUT_IMAGE = "image.png"
@@ -45,22 +46,19 @@ def skeletonize(img):
 
 def sort_points_nearest_neighbor(pixels):
     if len(pixels) == 0: return [], [], []
-    points_left = np.array(pixels, dtype=float)
+    points = np.array(pixels, dtype=float)
+    grid = PointGrid(points)  # local lookups instead of rescanning every pixel
     
-    path_x = [points_left[0][1]]
-    path_y = [points_left[0][0]]
+    current_idx, _ = grid.pop_nearest(points[0])
+    path_x = [points[current_idx][1]]
+    path_y = [points[current_idx][0]]
     path_laser = [False]
-    
-    current_point = points_left[0]
-    points_left = np.delete(points_left, 0, axis=0)
     JUMP_THRESHOLD = 20.0 
 
-    while len(points_left) > 0:
-        dists = np.sum((points_left - current_point)**2, axis=1)
-        nearest_idx = np.argmin(dists)
-        dist_sq = dists[nearest_idx]
+    while grid.remaining > 0:
+        nearest_idx, dist_sq = grid.pop_nearest(points[current_idx])
         
-        next_point = points_left[nearest_idx]
+        next_point = points[nearest_idx]
         path_x.append(next_point[1])
         path_y.append(next_point[0])
         
@@ -69,8 +67,7 @@ def sort_points_nearest_neighbor(pixels):
         else:
             path_laser.append(True)
             
-        current_point = next_point
-        points_left = np.delete(points_left, nearest_idx, axis=0)
+        current_idx = nearest_idx
 
     return path_x, path_y, path_laser
 
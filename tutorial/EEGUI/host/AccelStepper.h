@@ -0,0 +1,36 @@
+// Stand-in for AccelStepper: run() takes one step towards the target per
+// call, and every moveTo() target is kept in `targets` for tests, with the
+// pin levels at the time in `pins`
+#pragma once
+
+#include "Arduino.h"
+
+class AccelStepper {
+public:
+  enum { DRIVER = 1 };
+  AccelStepper(int, int, int) {}
+
+  void moveTo(long target) {
+    targetPosition = target;
+    targets.push_back(target);
+    pins.push_back(hostPins);
+  }
+  bool run() {
+    if (position == targetPosition) return false;
+    position += (targetPosition > position) ? 1 : -1;
+    return true;
+  }
+  long distanceToGo() { return targetPosition - position; }
+  long currentPosition() { return position; }
+  void setCurrentPosition(long value) { position = targetPosition = value; }
+  void setMaxSpeed(float) {}
+  void setAcceleration(float) {}
+  float speed() { return 0; }
+
+  std::vector<long> targets;
+  std::vector<uint64_t> pins;
+
+private:
+  long position = 0;
+  long targetPosition = 0;
+};
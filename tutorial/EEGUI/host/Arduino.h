@@ -0,0 +1,65 @@
+// Stand-in for the Arduino core so generated sketches build and run on a
+// PC (see build.py). Output levels are kept in hostPins, digitalRead()
+// reads HIGH (buttons released) and time is a counter that only delay()
+// advances, so runs are repeatable.
+#pragma once
+
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A0 14
+#define A1 15
+#define A2 16
+
+#define PROGMEM
+#define F(text) text
+inline uint8_t pgm_read_byte(const void *address) { return *(const uint8_t *)address; }
+inline uint16_t pgm_read_word(const void *address) { return *(const uint16_t *)address; }
+inline void *memcpy_P(void *target, const void *source, size_t size) { return memcpy(target, source, size); }
+
+inline std::atomic<unsigned long> hostMicros(0);
+inline std::atomic<uint64_t> hostPins(0);  // bit n: pin n is driven high (PWM: above 0)
+
+inline void setHostPin(int pin, bool high) {
+  if (high) hostPins |= (uint64_t)1 << pin;
+  else hostPins &= ~((uint64_t)1 << pin);
+}
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int pin, int value) { setHostPin(pin, value != LOW); }
+inline int digitalRead(int) { return HIGH; }
+inline void analogWrite(int pin, int value) { setHostPin(pin, value > 0); }
+inline unsigned long micros() { return hostMicros.load(); }
+inline unsigned long millis() { return hostMicros.load() / 1000; }
+inline void delayMicroseconds(unsigned int us) { hostMicros += us; }
+inline void delay(unsigned long ms) { hostMicros += ms * 1000; }
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(value, low, high) ((value) < (low) ? (low) : ((value) > (high) ? (high) : (value)))
+
+// Serial with nothing to read and output thrown away
+struct HostSerial {
+  void begin(long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int availableForWrite() { return 64; }
+  size_t write(uint8_t) { return 1; }
+  size_t write(const uint8_t *, size_t size) { return size; }
+  template <class T> size_t print(T) { return 0; }
+  template <class T> size_t println(T) { return 0; }
+  size_t println() { return 0; }
+};
+inline HostSerial Serial;
@@ -0,0 +1,12 @@
+// Stand-in for the EEPROM library: 1 KB of RAM, erased to zero
+#pragma once
+
+#include <stdint.h>
+
+struct HostEEPROM {
+  uint8_t read(int address) { return bytes[address]; }
+  void update(int address, uint8_t value) { bytes[address] = value; }
+  uint16_t length() { return sizeof(bytes); }
+  uint8_t bytes[1024] = {};
+};
+inline HostEEPROM EEPROM;
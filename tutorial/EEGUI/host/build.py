@@ -0,0 +1,101 @@
+"""
+Host Build for Laser Projector
+Compiles a generated sketch against the stand-in Arduino headers next to
+this file, so the player runs on a PC for tests:
+
+    python host/build.py laser.cpp -o laser_host [-D BOARD=BOARD_AVR]
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+from pathlib import Path
+from typing import List, Sequence
+
+HOST_DIR = Path(__file__).resolve().parent
+FLAGS = ["-std=gnu++17", "-O1", "-g", "-Wall", "-Wextra", "-pthread"]
+DEFAULT_DRIVER = "int main() {\n  setup();\n  for (;;) loop();\n}\n"
+
+# A function definition at the start of a line, as the Arduino IDE finds them
+DEFINITION = re.compile(r"^([A-Za-z_][\w<>\* ]*?[\s\*])([A-Za-z_]\w*)\(([^;{}]*)\)\s*\{", re.MULTILINE)
+KEYWORDS = {"if", "for", "while", "switch", "return", "else", "struct", "class"}
+
+
+def prototypes(code: str) -> List[str]:
+    """Declarations of the sketch's functions, which the Arduino IDE adds before compiling"""
+    found = []
+    for match in DEFINITION.finditer(code):
+        head, name, arguments = match.groups()
+        if head.split()[0] in KEYWORDS or name in KEYWORDS:
+            continue
+        found.append(f"{head}{name}({arguments});")
+    return found
+
+
+def _first_definition(code: str) -> int:
+    """Offset of the first function definition outside any #if block"""
+    depth = offset = 0
+    for line in code.splitlines(keepends=True):
+        directive = line.strip()
+        if directive.startswith("#if"):
+            depth += 1
+        elif directive.startswith("#endif"):
+            depth -= 1
+        elif depth == 0 and DEFINITION.match(line) and not line.startswith(tuple(KEYWORDS)):
+            return offset
+        offset += len(line)
+    return len(code)
+
+
+def host_source(sketch: str, driver: str = DEFAULT_DRIVER) -> str:
+    """One translation unit: the stand-in core, the prototypes, the sketch and a main()"""
+    # Prototypes go just before the first function, after the sketch's types
+    at = _first_definition(sketch)
+    return "\n".join([
+        '#include "Arduino.h"',
+        sketch[:at],
+        *prototypes(sketch),
+        sketch[at:],
+        driver,
+    ])
+
+
+def build(
+    sketch_path: Path,
+    output: Path,
+    driver: str = DEFAULT_DRIVER,
+    defines: Sequence[str] = (),
+    compiler: str = "g++"
+) -> str:
+    """
+    Build a host executable of the sketch with driver as its main(), returns
+    the compiler's warnings. Raises RuntimeError when it does not compile.
+    """
+    source = Path(output).with_suffix(".host.cpp")
+    source.write_text(host_source(Path(sketch_path).read_text(), driver))
+    command = [compiler, *FLAGS, f"-I{HOST_DIR}", *(f"-D{d}" for d in defines), str(source), "-o", str(output)]
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"Host build failed:\n{result.stderr}")
+    return result.stderr
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description="Build a generated sketch for the host")
+    parser.add_argument("sketch")
+    parser.add_argument("-o", "--output", default="laser_host")
+    parser.add_argument("-D", "--define", action="append", default=[], help="e.g. BOARD=BOARD_AVR")
+    parser.add_argument("--compiler", default="g++")
+    args = parser.parse_args(argv)
+    try:
+        warnings = build(Path(args.sketch), Path(args.output), defines=args.define, compiler=args.compiler)
+    except RuntimeError as e:
+        print(e, file=sys.stderr)
+        return 1
+    print(warnings, end="", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
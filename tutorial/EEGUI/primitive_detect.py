@@ -0,0 +1,310 @@
+"""
+Primitive Detection for Laser Projector
+Finds straight lines, circles and arcs among skeleton pixels
+"""
+
+import math
+import cv2
+import numpy as np
+from dataclasses import dataclass
+from typing import List, Tuple
+
+
+INLIER_DISTANCE = 1.5      # pixels from the primitive that count as on it
+MIN_PRIMITIVE_LENGTH = 30  # shortest line or arc worth replacing, pixels
+MIN_COVERAGE = 0.7         # inliers per pixel of primitive length
+MAX_ARC_GAP = 6.0          # pixels missing from an arc before it is split
+MIN_RADIUS = 8
+MIN_ARC_SWEEP = math.pi / 4  # flatter arcs are left to the line finder
+RANSAC_ITERATIONS = 400
+RANSAC_SCORE_POINTS = 2000  # candidates a RANSAC circle is scored on
+MAX_CIRCLE_MISSES = 8       # rejected circles in a row before giving up
+
+
+@dataclass
+class DetectedPrimitive:
+    """
+    A primitive in pixel coordinates (x right, y down). Lines use start and
+    end; circles and arcs use center, radius and the angle range in radians
+    (a circle spans 2*pi).
+    """
+    kind: str
+    start: Tuple[float, float] = (0.0, 0.0)
+    end: Tuple[float, float] = (0.0, 0.0)
+    center: Tuple[float, float] = (0.0, 0.0)
+    radius: float = 0.0
+    start_angle: float = 0.0
+    sweep: float = 0.0
+    inliers: int = 0
+
+    @property
+    def length(self) -> float:
+        if self.kind == "line":
+            return math.dist(self.start, self.end)
+        return self.radius * abs(self.sweep)
+
+
+def _distance_to(points: np.ndarray, primitive: DetectedPrimitive) -> np.ndarray:
+    """Distance of every point to a primitive, infinite outside an arc's sweep"""
+    if primitive.kind == "line":
+        a, b = np.array(primitive.start), np.array(primitive.end)
+        ab = b - a
+        t = np.clip(((points - a) @ ab) / max(ab @ ab, 1e-9), 0.0, 1.0)
+        return np.hypot(*(points - a - np.outer(t, ab)).T)
+    offset = points - np.array(primitive.center)
+    distance = np.abs(np.hypot(*offset.T) - primitive.radius)
+    angle = (np.arctan2(offset[:, 1], offset[:, 0]) - primitive.start_angle) % (2 * np.pi)
+    distance[angle > primitive.sweep + 1e-9] = np.inf
+    return distance
+
+
+def _find_lines(shape: Tuple[int, int], points: np.ndarray, keep: np.ndarray) -> List[DetectedPrimitive]:
+    """Probabilistic Hough proposals, kept when skeleton pixels cover them"""
+    remaining = np.zeros(shape, np.uint8)
+    remaining[points[keep, 1].astype(int), points[keep, 0].astype(int)] = 255
+    proposals = cv2.HoughLinesP(
+        remaining, 1, np.pi / 180, threshold=MIN_PRIMITIVE_LENGTH,
+        minLineLength=MIN_PRIMITIVE_LENGTH, maxLineGap=int(MAX_ARC_GAP)
+    )
+    if proposals is None:
+        return []
+
+    # Longest first, so a long line is not eaten by its own fragments
+    segments = sorted(
+        proposals.reshape(-1, 4).astype(float),
+        key=lambda s: -math.hypot(s[2] - s[0], s[3] - s[1])
+    )
+    lines = []
+    for x1, y1, x2, y2 in segments:
+        origin = np.array([(x1 + x2) / 2, (y1 + y2) / 2])
+        direction = np.array([x2 - x1, y2 - y1]) / math.hypot(x2 - x1, y2 - y1)
+        half = math.hypot(x2 - x1, y2 - y1) / 2
+        if not keep.any():
+            break
+        
+        # Hough angles are 1 degree apart, refine on the pixels near the proposal
+        for _ in range(2):
+            offset = points - origin
+            near = keep & (np.abs(offset @ direction) <= half) \
+                & (np.abs(offset @ [-direction[1], direction[0]]) <= 2 * INLIER_DISTANCE)
+            if near.sum() < 2:
+                break
+            origin = points[near].mean(axis=0)
+            _, _, axes = np.linalg.svd(points[near] - origin)
+            direction = axes[0]
+        
+        # Follow the line both ways while the skeleton keeps it unbroken
+        offset = points - origin
+        on_line = keep & (np.abs(offset @ [-direction[1], direction[0]]) <= INLIER_DISTANCE)
+        run = _unbroken_run(offset @ direction, on_line)
+        if run is None:
+            continue
+        low, high, inliers = run
+        count = int(inliers.sum())
+        if high - low < MIN_PRIMITIVE_LENGTH or count < MIN_COVERAGE * (high - low):
+            continue
+        lines.append(DetectedPrimitive(
+            "line", start=tuple(origin + direction * low),
+            end=tuple(origin + direction * high), inliers=count
+        ))
+        keep &= ~inliers
+    return _merge_lines(lines)
+
+
+def _unbroken_run(along: np.ndarray, candidates: np.ndarray):
+    """Range of positions around 0 with no gap over MAX_ARC_GAP, and its mask"""
+    positions = np.sort(along[candidates])
+    if len(positions) == 0:
+        return None
+    center = np.searchsorted(positions, 0.0)
+    center = min(center, len(positions) - 1)
+    first = last = center
+    while first > 0 and positions[first] - positions[first - 1] <= MAX_ARC_GAP:
+        first -= 1
+    while last < len(positions) - 1 and positions[last + 1] - positions[last] <= MAX_ARC_GAP:
+        last += 1
+    low, high = positions[first], positions[last]
+    return low, high, candidates & (along >= low) & (along <= high)
+
+
+def _merge_lines(lines: List[DetectedPrimitive]) -> List[DetectedPrimitive]:
+    """Join collinear pieces that a broken skeleton split into several lines"""
+    merged = True
+    while merged:
+        merged = False
+        for i in range(len(lines)):
+            for j in range(i + 1, len(lines)):
+                a, b = lines[i], lines[j]
+                ends = np.array([a.start, a.end, b.start, b.end])
+                direction = ends[1] - ends[0]
+                direction /= max(np.hypot(*direction), 1e-9)
+                other = ends[3] - ends[2]
+                other /= max(np.hypot(*other), 1e-9)
+                normal = np.array([-direction[1], direction[0]])
+                offsets = (ends[2:] - ends[0]) @ normal
+                gap = min(math.dist(p, q) for p in ends[:2] for q in ends[2:])
+                if abs(direction @ other) < math.cos(math.radians(3)) \
+                        or np.abs(offsets).max() > INLIER_DISTANCE \
+                        or gap > 2 * MAX_ARC_GAP:
+                    continue
+                along = (ends - ends[0]) @ direction
+                lines[i] = DetectedPrimitive(
+                    "line",
+                    start=tuple(ends[0] + direction * along.min()),
+                    end=tuple(ends[0] + direction * along.max()),
+                    inliers=a.inliers + b.inliers
+                )
+                del lines[j]
+                merged = True
+                break
+            if merged:
+                break
+    return lines
+
+
+def _circle_through(p1: np.ndarray, p2: np.ndarray, p3: np.ndarray):
+    ax, ay = p1
+    bx, by = p2
+    cx, cy = p3
+    d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by))
+    if abs(d) < 1e-9:
+        return None
+    ux = ((ax * ax + ay * ay) * (by - cy) + (bx * bx + by * by) * (cy - ay) + (cx * cx + cy * cy) * (ay - by)) / d
+    uy = ((ax * ax + ay * ay) * (cx - bx) + (bx * bx + by * by) * (ax - cx) + (cx * cx + cy * cy) * (bx - ax)) / d
+    return np.array([ux, uy]), math.hypot(ax - ux, ay - uy)
+
+
+def _least_squares_circle(points: np.ndarray) -> Tuple[np.ndarray, float]:
+    """Algebraic (Kasa) fit, to refine the three-point RANSAC circle"""
+    x, y = points[:, 0], points[:, 1]
+    system = np.column_stack([x, y, np.ones(len(x))])
+    (a, b, c), *_ = np.linalg.lstsq(system, x * x + y * y, rcond=None)
+    center = np.array([a / 2, b / 2])
+    return center, math.sqrt(max(c + center @ center, 0.0))
+
+
+def _arc_extent(angles: np.ndarray, radius: float) -> Tuple[float, float, np.ndarray]:
+    """
+    Longest angular run of inliers without a gap wider than a few pixels:
+    start angle, sweep and the mask of the inliers inside it
+    """
+    order = np.argsort(angles)
+    sorted_angles = angles[order]
+    gaps = np.diff(np.concatenate([sorted_angles, sorted_angles[:1] + 2 * np.pi]))
+    max_gap = MAX_ARC_GAP / radius
+    breaks = np.flatnonzero(gaps > max_gap)
+    if len(breaks) == 0:
+        return 0.0, 2 * np.pi, np.ones(len(angles), bool)
+
+    # Runs go from just after one break to the next one, wrapping around
+    best_sweep, best = -1.0, (0, 0)
+    for i, brk in enumerate(breaks):
+        first = (brk + 1) % len(angles)
+        last = breaks[(i + 1) % len(breaks)]
+        sweep = (sorted_angles[last] - sorted_angles[first]) % (2 * np.pi)
+        if sweep > best_sweep:
+            best_sweep, best = sweep, (first, last)
+    first, last = best
+    start = sorted_angles[first]
+    inside = ((angles - start) % (2 * np.pi)) <= best_sweep + 1e-9
+    return float(start), float(best_sweep), inside
+
+
+def _find_circles(points: np.ndarray, keep: np.ndarray, max_radius: float) -> List[DetectedPrimitive]:
+    """
+    RANSAC circles, each cut down to its longest unbroken arc. A circle
+    whose arc falls short drops out of the search, not its pixels: they
+    stay in keep for the line finder. Proposals are scored on a random
+    subset of the candidates, and the search ends after MAX_CIRCLE_MISSES
+    short arcs in a row, so busy images don't take a full RANSAC run per
+    rejected circle.
+    """
+    rng = np.random.default_rng(0)
+    found = []
+    searching = keep.copy()
+    misses = 0
+    while searching.sum() >= MIN_PRIMITIVE_LENGTH and misses < MAX_CIRCLE_MISSES:
+        candidates = points[searching]
+        scored = candidates
+        if len(candidates) > RANSAC_SCORE_POINTS:
+            scored = candidates[rng.choice(len(candidates), RANSAC_SCORE_POINTS, replace=False)]
+        best = None
+        for _ in range(RANSAC_ITERATIONS):
+            sample = candidates[rng.choice(len(candidates), 3, replace=False)]
+            circle = _circle_through(*sample)
+            if circle is None or not MIN_RADIUS <= circle[1] <= max_radius:
+                continue
+            center, radius = circle
+            distance = np.abs(np.hypot(*(scored - center).T) - radius)
+            count = int((distance <= INLIER_DISTANCE).sum())
+            if best is None or count > best[2]:
+                best = (center, radius, count)
+        if best is None or best[2] * len(candidates) < MIN_PRIMITIVE_LENGTH * MIN_COVERAGE * len(scored):
+            break
+
+        center, radius, _ = best
+        rejected = searching & (np.abs(np.hypot(*(points - center).T) - radius) <= INLIER_DISTANCE)
+        for _ in range(2):
+            distance = np.abs(np.hypot(*(points - center).T) - radius)
+            inliers = searching & (distance <= 2 * INLIER_DISTANCE)
+            center, radius = _least_squares_circle(points[inliers])
+        distance = np.abs(np.hypot(*(points - center).T) - radius)
+        inliers = searching & (distance <= INLIER_DISTANCE)
+        indices = np.flatnonzero(inliers)
+        angles = np.arctan2(points[indices, 1] - center[1], points[indices, 0] - center[0])
+        start, sweep, inside = _arc_extent(angles, radius)
+        count = int(inside.sum())
+        if sweep < MIN_ARC_SWEEP or radius * sweep < MIN_PRIMITIVE_LENGTH \
+                or count < MIN_COVERAGE * radius * sweep:
+            searching &= ~rejected  # try the next best circle
+            misses += 1
+            continue
+        misses = 0
+
+        closed = sweep >= 2 * np.pi - 8.0 / radius
+        found.append(DetectedPrimitive(
+            "circle" if closed else "arc",
+            center=(float(center[0]), float(center[1])), radius=float(radius),
+            start_angle=start, sweep=2 * np.pi if closed else sweep, inliers=count
+        ))
+        keep[indices[inside]] = False
+        searching[indices[inside]] = False
+    return found
+
+
+def find_primitives(skel: np.ndarray) -> Tuple[List[DetectedPrimitive], np.ndarray]:
+    """
+    Detect circles and arcs (RANSAC) and then lines (Hough) on a skeleton
+    image. Circles go first, as their chords would pass for short lines.
+    Returns the primitives and the (row, col) pixels none of them explain,
+    for the point-chain fallback.
+    """
+    pixels = np.column_stack(np.where(skel > 0))
+    if len(pixels) == 0:
+        return [], pixels
+    points = pixels[:, ::-1].astype(float)  # x, y
+    keep = np.ones(len(points), bool)
+
+    primitives = _find_circles(points, keep, 0.5 * max(skel.shape))
+    primitives += _find_lines(skel.shape, points, keep)
+    
+    # Thick strokes leave stray pixels beside the ones taken as inliers
+    for primitive in primitives:
+        keep &= _distance_to(points, primitive) > 2 * INLIER_DISTANCE
+    return primitives, pixels[keep]
+
+
+def primitive_points(primitive: DetectedPrimitive, tolerance: float = 1.0) -> List[Tuple[float, float]]:
+    """Fewest points that keep the drawn chords within tolerance pixels"""
+    if primitive.kind == "line":
+        return [primitive.start, primitive.end]
+
+    r = primitive.radius
+    step = 2 * math.acos(max(-1.0, 1 - tolerance / r)) if r > tolerance else math.pi / 2
+    count = max(2, math.ceil(abs(primitive.sweep) / step))
+    cx, cy = primitive.center
+    return [
+        (cx + r * math.cos(primitive.start_angle + primitive.sweep * i / count),
+         cy + r * math.sin(primitive.start_angle + primitive.sweep * i / count))
+        for i in range(count + 1)
+    ]
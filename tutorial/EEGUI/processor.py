@@ -3,12 +3,24 @@ Image Processor Module for Laser Projector
 Converts images to stepper motor angle coordinates
 """
 
+import os
 import cv2
 import numpy as np
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from typing import Tuple, List, Optional
 from pathlib import Path
 
+from primitive_detect import DetectedPrimitive, find_primitives, primitive_points
+from resample import resample_strokes, simplify_strokes
+from skeleton_graph import trace_skeleton
+from spatial_index import PointGrid
+from stage_cache import StageCache
+from stroke_order import greedy_order, optimize_stroke_order
+from thinning import THINNING_METHODS, thin
+
+
+MIN_POINTS = 2  # the two ends of a single stroke
+
 
 @dataclass
 class ProcessingConfig:
@@ -17,6 +29,34 @@ class ProcessingConfig:
     wall_distance_meters: float = 1.6
     projected_size_meters: float = 4.0
     aspect_ratio_correction: float = 1.0
+    detect_primitives: bool = False  # draw lines, circles and arcs as primitives
+    travel_budget_s: float = 2.0  # cap on stroke order optimization, 0 keeps the traced order
+    trace_graph: bool = False  # walk the skeleton into strokes, default orders pixels by distance alone
+    skeleton_method: str = "morphological"  # repeated opening, or "zhang_suen"/"guo_hall" thinning
+    simplify_tolerance_mm: float = 0.0  # on the wall, within max_points; straight runs collapse, 0 to skip
+    
+    def __post_init__(self):
+        # Fewer points than that resample every stroke away
+        if self.max_points < MIN_POINTS:
+            raise ValueError(f"Max points must be at least {MIN_POINTS}")
+    
+    def simplify_tolerance(self) -> float:
+        """simplify_tolerance_mm as a fraction of the projected size, see path_angles"""
+        return self.simplify_tolerance_mm / 1000.0 / self.projected_size_meters
+    
+    def path_inputs(self) -> tuple:
+        """What the pixel path depends on, none of it geometry"""
+        return (
+            self.max_points, self.detect_primitives, self.travel_budget_s, self.trace_graph,
+            self.skeleton_method
+        )
+    
+    def geometry_inputs(self) -> tuple:
+        """What the angle stage adds to the pixel path, see path_angles"""
+        return (
+            self.wall_distance_meters, self.projected_size_meters, self.aspect_ratio_correction,
+            self.simplify_tolerance_mm
+        )
 
 
 @dataclass
@@ -28,6 +68,10 @@ class ProcessingResult:
     point_count: int
     success: bool
     message: str
+    primitives: List[DetectedPrimitive] = field(default_factory=list)
+    travel_before: float = 0.0  # blanked travel per frame in image pixels,
+    travel_after: float = 0.0   # before and after stroke ordering
+    resample_error: float = 0.0  # worst distance in image pixels from a skeleton pixel to the drawn path
 
 
 def resize_maintain_aspect(img: np.ndarray, max_size: int = 600) -> np.ndarray:
@@ -38,12 +82,19 @@ def resize_maintain_aspect(img: np.ndarray, max_size: int = 600) -> np.ndarray:
     return cv2.resize(img, (new_w, new_h))
 
 
-def skeletonize(img: np.ndarray) -> np.ndarray:
-    """Extract skeleton from grayscale image"""
+def skeletonize(img: np.ndarray, method: str = "morphological") -> np.ndarray:
+    """
+    Extract skeleton from grayscale image, by repeated opening or by one of
+    the thinning methods (one-pixel lines in fewer passes)
+    """
     thresh = cv2.adaptiveThreshold(
         img, 255, cv2.ADAPTIVE_THRESH_GAUSSIAN_C,
         cv2.THRESH_BINARY_INV, 11, 2
     )
+    if method in THINNING_METHODS:
+        return thin(thresh, method)
+    if method != "morphological":
+        raise ValueError(f"Unknown skeleton method: {method}")
     element = cv2.getStructuringElement(cv2.MORPH_CROSS, (3, 3))
     skel = np.zeros(img.shape, np.uint8)
     
@@ -59,26 +110,27 @@ def skeletonize(img: np.ndarray) -> np.ndarray:
 
 
 def sort_points_nearest_neighbor(pixels: np.ndarray) -> Tuple[List[float], List[float], List[bool]]:
-    """Sort pixels using nearest neighbor algorithm to create continuous path"""
+    """
+    Sort pixels using nearest neighbor algorithm to create continuous path.
+    A PointGrid keeps each lookup local, so this is close to O(n log n)
+    instead of rescanning every remaining pixel.
+    """
     if len(pixels) == 0:
         return [], [], []
     
-    points_left = np.array(pixels, dtype=float)
+    points = np.array(pixels, dtype=float)
+    grid = PointGrid(points)
     
-    path_x = [points_left[0][1]]
-    path_y = [points_left[0][0]]
+    current_idx, _ = grid.pop_nearest(points[0])
+    path_x = [points[current_idx][1]]
+    path_y = [points[current_idx][0]]
     path_laser = [False]
-    
-    current_point = points_left[0]
-    points_left = np.delete(points_left, 0, axis=0)
     JUMP_THRESHOLD = 20.0
 
-    while len(points_left) > 0:
-        dists = np.sum((points_left - current_point) ** 2, axis=1)
-        nearest_idx = np.argmin(dists)
-        dist_sq = dists[nearest_idx]
+    while grid.remaining > 0:
+        nearest_idx, dist_sq = grid.pop_nearest(points[current_idx])
         
-        next_point = points_left[nearest_idx]
+        next_point = points[nearest_idx]
         path_x.append(next_point[1])
         path_y.append(next_point[0])
         
@@ -87,48 +139,214 @@ def sort_points_nearest_neighbor(pixels: np.ndarray) -> Tuple[List[float], List[
         else:
             path_laser.append(True)
         
-        current_point = next_point
-        points_left = np.delete(points_left, nearest_idx, axis=0)
+        current_idx = nearest_idx
 
     return path_x, path_y, path_laser
 
 
-def process_image_to_pixels(
-    image_path: str,
-    max_points: int
-) -> Tuple[List[float], List[float], List[bool], int, int]:
-    """Process image and extract pixel path"""
+def split_strokes(
+    xs: List[float], ys: List[float], laser: List[bool]
+) -> List[List[Tuple[float, float]]]:
+    """Cut a path into its lit strokes at every blanked move"""
+    strokes = []
+    for x, y, on in zip(xs, ys, laser):
+        if not on or not strokes:
+            strokes.append([])
+        strokes[-1].append((x, y))
+    return strokes
+
+
+JOIN_GAP = 1.5  # traced strokes this close (touching pixels, a shared junction) stay lit
+
+
+def _join_strokes(
+    strokes: List[List[Tuple[float, float]]],
+    join_gap: float = 0.0
+) -> Tuple[List[float], List[float], List[bool]]:
+    """
+    Play strokes in order, each reached by a blanked move unless it starts
+    within join_gap of where the last one ended
+    """
+    path_x, path_y, path_laser = [], [], []
+    for stroke in strokes:
+        joined = bool(path_x) and np.hypot(stroke[0][0] - path_x[-1], stroke[0][1] - path_y[-1]) <= join_gap
+        if joined and stroke[0] == (path_x[-1], path_y[-1]):
+            stroke = stroke[1:]
+        for i, (x, y) in enumerate(stroke):
+            path_x.append(x)
+            path_y.append(y)
+            path_laser.append(i > 0 or joined)
+    return path_x, path_y, path_laser
+
+
+def skeleton_strokes(
+    skel: np.ndarray,
+    trace_graph: bool = False
+) -> Tuple[List[List[Tuple[float, float]]], float]:
+    """
+    Strokes (x, y) of a skeleton image, with the gap that still joins two of
+    them lit: traced from endpoint or junction to the next one, or cut from
+    the nearest-neighbour pixel path at its blanked jumps
+    """
+    if trace_graph:
+        graph = trace_skeleton(skel)
+        if not graph.strokes:
+            return [], JOIN_GAP
+        strokes = [[(float(x), float(y)) for x, y in stroke.pixels] for stroke in graph.strokes]
+        # Chain the branches that meet at a junction into longer strokes first
+        return split_strokes(*_join_strokes(greedy_order(strokes), JOIN_GAP)), JOIN_GAP
+    pixels = np.column_stack(np.where(skel > 0))
+    if len(pixels) == 0:
+        return [], 0.0
+    return split_strokes(*sort_points_nearest_neighbor(pixels)), 0.0
+
+
+MIN_LEFTOVER_CHAIN = 3  # shorter traced chains next to primitives are fit residue
+
+
+def primitive_path(
+    skel: np.ndarray,
+    max_points: int,
+    travel_budget_s: float = 2.0,
+    trace_graph: bool = False,
+    reference: Optional[List[List[Tuple[float, float]]]] = None
+) -> Tuple[List[float], List[float], List[bool], List[DetectedPrimitive], Tuple[float, float], float]:
+    """
+    Draw detected lines, circles and arcs with as few points as they need,
+    and the pixels they don't explain as skeleton strokes, all resampled
+    together to max_points. Also returns the blanked travel before and
+    after stroke ordering and the resampling error. reference: see
+    optimize_stroke_order.
+    """
+    primitives, leftover = find_primitives(skel)
+    strokes = [primitive_points(primitive) for primitive in primitives]
+    join_gap = 0.0
+    
+    if len(leftover) > 0:
+        leftover_skel = np.zeros_like(skel)
+        leftover_skel[leftover[:, 0], leftover[:, 1]] = 255
+        chains, join_gap = skeleton_strokes(leftover_skel, trace_graph)
+        # Shorter chains are stray pixels the primitive fits left behind
+        strokes.extend(chain for chain in chains if len(chain) >= MIN_LEFTOVER_CHAIN)
+    
+    # Primitives hold few points that each bend the drawing, so the budget
+    # mostly thins the leftover chains
+    strokes, error = resample_strokes(strokes, max_points)
+    if not strokes:
+        return [], [], [], primitives, (0.0, 0.0), 0.0
+    strokes, before, after = optimize_stroke_order(greedy_order(strokes), travel_budget_s, reference)
+    path_x, path_y, path_laser = _join_strokes(strokes, join_gap)
+    return path_x, path_y, path_laser, primitives, (before, after), error
+
+
+def prepare_gray(img: np.ndarray) -> np.ndarray:
+    """Resize and blur a BGR(A) image into the grayscale the skeleton is taken from"""
+    img = resize_maintain_aspect(img, 600)
+    code = cv2.COLOR_BGRA2GRAY if img.ndim == 3 and img.shape[2] == 4 else cv2.COLOR_BGR2GRAY
+    gray = cv2.cvtColor(img, code) if img.ndim == 3 else img
+    return cv2.GaussianBlur(gray, (5, 5), 0)
+
+
+def load_gray(image_path: str) -> np.ndarray:
+    """Load an image as prepare_gray makes it"""
     img = cv2.imread(image_path)
     if img is None:
         raise FileNotFoundError(f"Could not load image: {image_path}")
+    return prepare_gray(img)
+
+
+def skeleton_path(
+    skel: np.ndarray,
+    max_points: int,
+    detect_primitives: bool = False,
+    travel_budget_s: float = 2.0,
+    trace_graph: bool = False,
+    reference: Optional[List[List[Tuple[float, float]]]] = None
+) -> Tuple[List[float], List[float], List[bool], List[DetectedPrimitive], Tuple[float, float], float]:
+    """
+    Ordered pixel path of a skeleton, see process_image_to_pixels. Pass the
+    previous frame's strokes as reference to keep an animation's order and
+    start point steady (see optimize_stroke_order).
+    """
+    if not skel.any():
+        return [], [], [], [], (0.0, 0.0), 0.0
     
-    img = resize_maintain_aspect(img, 600)
-    gray = cv2.cvtColor(img, cv2.COLOR_BGR2GRAY)
-    gray = cv2.GaussianBlur(gray, (5, 5), 0)
+    if detect_primitives:
+        return primitive_path(skel, max_points, travel_budget_s, trace_graph, reference)
     
-    skel = skeletonize(gray)
-    pixels = np.column_stack(np.where(skel > 0))
+    strokes, join_gap = skeleton_strokes(skel, trace_graph)
     
-    if len(pixels) == 0:
-        return [], [], [], 0, 0
+    # Spend max points where the path bends
+    strokes, error = resample_strokes(strokes, max_points)
     
-    raw_x, raw_y, raw_laser = sort_points_nearest_neighbor(pixels)
+    # Reorder the strokes to shorten the jumps between them
+    strokes, before, after = optimize_stroke_order(strokes, travel_budget_s, reference)
+    final_x, final_y, final_laser = _join_strokes(strokes, join_gap)
+
+    return final_x, final_y, final_laser, [], (before, after), error
+
+
+def _pixel_stages(
+    image_path: str,
+    cache: Optional[StageCache],
+    max_points: int,
+    detect_primitives: bool,
+    travel_budget_s: float,
+    trace_graph: bool,
+    skeleton_method: str
+) -> Tuple[tuple, int, int, str]:
+    """
+    Gray image, skeleton and pixel path, each read from the cache when its
+    key matches. Returns the skeleton_path result, the image size and the
+    path stage's key ("" without a cache) for stages further on.
+    """
+    if cache is None:
+        skel = skeletonize(load_gray(image_path), skeleton_method)
+        path = skeleton_path(skel, max_points, detect_primitives, travel_budget_s, trace_graph)
+        return path, skel.shape[1], skel.shape[0], ""
     
-    # Downsample to max points
-    total_pixels = len(raw_x)
-    step = max(1, int(total_pixels / max_points))
+    try:
+        image_key = cache.file_key(image_path)
+    except OSError:
+        raise FileNotFoundError(f"Could not load image: {image_path}")
+    gray_key = cache.key("gray", image_key)
+    skel_key = cache.key("skeleton", gray_key, skeleton_method)
+    path_key = cache.key("path", skel_key, max_points, detect_primitives, travel_budget_s, trace_graph)
     
-    final_x = raw_x[::step]
-    final_y = raw_y[::step]
-    final_laser = raw_laser[::step]
+    def path_stage() -> tuple:
+        skel = cache.get(skel_key, lambda: skeletonize(
+            cache.get(gray_key, lambda: load_gray(image_path)), skeleton_method
+        ))
+        path = skeleton_path(skel, max_points, detect_primitives, travel_budget_s, trace_graph)
+        return path, skel.shape
     
-    # Ensure we include the last point
-    if (len(raw_x) - 1) % step != 0:
-        final_x.append(raw_x[-1])
-        final_y.append(raw_y[-1])
-        final_laser.append(True)
+    # Earlier stages are only read when a later one has to run
+    path, size = cache.get(path_key, path_stage)
+    return path, size[1], size[0], path_key
 
-    return final_x, final_y, final_laser, img.shape[1], img.shape[0]
+
+def process_image_to_pixels(
+    image_path: str,
+    max_points: int,
+    detect_primitives: bool = False,
+    travel_budget_s: float = 2.0,
+    trace_graph: bool = False,
+    skeleton_method: str = "morphological",
+    cache: Optional[StageCache] = None
+) -> Tuple[List[float], List[float], List[bool], int, int, List[DetectedPrimitive], Tuple[float, float], float]:
+    """
+    Process image and extract pixel path, with the blanked travel before and
+    after stroke ordering and the resampling error (see resample_strokes).
+    With a cache, stages whose inputs are unchanged are read back instead
+    of rerun.
+    """
+    path, w, h, _ = _pixel_stages(
+        image_path, cache, max_points, detect_primitives, travel_budget_s, trace_graph, skeleton_method
+    )
+    final_x, final_y, final_laser, primitives, travel, error = path
+    if not final_x:
+        return [], [], [], 0, 0, [], (0.0, 0.0), 0.0
+    return final_x, final_y, final_laser, w, h, primitives, travel, error
 
 
 def convert_to_angles(
@@ -171,65 +389,169 @@ def convert_to_angles(
     return theta_x.tolist(), theta_y.tolist()
 
 
-def process_image(image_path: str, config: ProcessingConfig) -> ProcessingResult:
+def path_angles(
+    path: tuple,
+    img_width: int,
+    img_height: int,
+    config: ProcessingConfig
+) -> Tuple[List[float], List[float], List[bool], float]:
     """
-    Main processing function - takes image path and config, returns angles and laser states
+    The angle stage of a skeleton_path result: its strokes simplified to
+    config.simplify_tolerance_mm on the wall, then convert_to_angles. The
+    tolerance scales with the projected size, so it is applied here and
+    the pixel path stays independent of geometry; max_points is then a
+    cap that simplification only goes below. Returns the angles, the laser
+    states and the path error, the simplification's included.
     """
-    try:
-        # Process image to get pixel path
-        raw_x, raw_y, laser_bools, w, h = process_image_to_pixels(
-            image_path, config.max_points
-        )
-        
-        if not raw_x:
-            return ProcessingResult(
-                x_angles=[],
-                y_angles=[],
-                laser_states=[],
-                point_count=0,
-                success=False,
-                message="No drawable content found in image"
-            )
-        
-        # Convert to angles
-        x_angles, y_angles = convert_to_angles(raw_x, raw_y, w, h, config)
-        
-        # Round angles for cleaner output
-        x_angles = [round(x, 2) for x in x_angles]
-        y_angles = [round(y, 2) for y in y_angles]
-        
-        # Check angle bounds
-        warning = ""
-        if min(x_angles) < 0 or max(x_angles) > 90:
-            warning = " Warning: Some X angles outside 0-90° range."
-        if min(y_angles) < 0 or max(y_angles) > 90:
-            warning += " Warning: Some Y angles outside 0-90° range."
-        
-        return ProcessingResult(
-            x_angles=x_angles,
-            y_angles=y_angles,
-            laser_states=laser_bools,
-            point_count=len(x_angles),
-            success=True,
-            message=f"Successfully processed {len(x_angles)} points.{warning}"
-        )
-        
-    except FileNotFoundError as e:
-        return ProcessingResult(
-            x_angles=[],
-            y_angles=[],
-            laser_states=[],
-            point_count=0,
-            success=False,
-            message=str(e)
-        )
-    except Exception as e:
-        return ProcessingResult(
-            x_angles=[],
-            y_angles=[],
-            laser_states=[],
-            point_count=0,
-            success=False,
-            message=f"Processing error: {str(e)}"
-        )
+    x_pixels, y_pixels, laser, _, _, error = path
+    tolerance_px = config.simplify_tolerance() * max(img_width, img_height)
+    if tolerance_px > 0:
+        # Measured as on the wall, where y is stretched like convert_to_angles does
+        scale = (1.0, abs(config.aspect_ratio_correction))
+        strokes, dropped = simplify_strokes(split_strokes(x_pixels, y_pixels, laser), tolerance_px, scale)
+        x_pixels = [x for stroke in strokes for x, _ in stroke]
+        y_pixels = [y for stroke in strokes for _, y in stroke]
+        laser = [i > 0 for stroke in strokes for i in range(len(stroke))]
+        error += dropped  # both distances can add up at one pixel
+    x_angles, y_angles = convert_to_angles(x_pixels, y_pixels, img_width, img_height, config)
+    return x_angles, y_angles, list(laser), error
+
+
+def failure_result(message: str) -> ProcessingResult:
+    """ProcessingResult of a run that produced nothing to draw"""
+    return ProcessingResult(
+        x_angles=[],
+        y_angles=[],
+        laser_states=[],
+        point_count=0,
+        success=False,
+        message=message
+    )
+
+
+def path_result(path: tuple, angles: tuple) -> ProcessingResult:
+    """ProcessingResult of a skeleton_path result and its path_angles, with range warnings"""
+    primitives, travel = path[3:5]
+    x_angles, y_angles, laser_bools, error = angles
+    
+    # Round angles for cleaner output
+    x_angles = [round(x, 2) for x in x_angles]
+    y_angles = [round(y, 2) for y in y_angles]
+    
+    # Check angle bounds
+    warning = ""
+    if min(x_angles) < 0 or max(x_angles) > 90:
+        warning = " Warning: Some X angles outside 0-90° range."
+    if min(y_angles) < 0 or max(y_angles) > 90:
+        warning += " Warning: Some Y angles outside 0-90° range."
+    
+    detected = ""
+    if primitives:
+        kinds = [p.kind for p in primitives]
+        detected = " Primitives: " + ", ".join(
+            f"{kinds.count(kind)} {kind}" + ("s" if kinds.count(kind) > 1 else "")
+            for kind in ("line", "circle", "arc") if kind in kinds
+        ) + "."
+    travel_before, travel_after = travel
+    travel_note = ""
+    if travel_before > 0:
+        travel_note = f" Blanked travel {travel_before:.0f} -> {travel_after:.0f} px."
+    error_note = f" Path error {error:.1f} px."
+    
+    return ProcessingResult(
+        x_angles=x_angles,
+        y_angles=y_angles,
+        laser_states=list(laser_bools),
+        point_count=len(x_angles),
+        success=True,
+        message=f"Successfully processed {len(x_angles)} points.{detected}{travel_note}{error_note}{warning}",
+        primitives=primitives,
+        travel_before=travel_before,
+        travel_after=travel_after,
+        resample_error=error
+    )
 
+
+class ProcessingSession:
+    """
+    Keeps the pixel path and angles of the last run, with the inputs they
+    were made from, so the next run only redoes the stages downstream of
+    what changed: image or path parameters -> pixel path -> angles. A
+    geometry-only change (wall distance, projected size, aspect, the
+    simplification on the wall) just reruns path_angles, fast enough to
+    follow every keystroke.
+    """
+    
+    def __init__(self, cache: Optional[StageCache] = None):
+        self.cache = cache
+        self.rerun: List[str] = []  # stages the last process() call ran
+        self._path_inputs: Optional[tuple] = None
+        self._path: Optional[tuple] = None
+        self._path_key = ""
+        self._angle_inputs: Optional[tuple] = None
+        self._angles: Optional[tuple] = None
+    
+    def _image_inputs(self, image_path: str) -> tuple:
+        try:
+            stat = os.stat(image_path)
+        except OSError:
+            raise FileNotFoundError(f"Could not load image: {image_path}")
+        return (os.path.abspath(image_path), stat.st_mtime_ns, stat.st_size)
+    
+    def has_path(self, image_path: str, config: ProcessingConfig) -> bool:
+        """Whether process() would only have to convert angles"""
+        try:
+            inputs = self._image_inputs(image_path) + config.path_inputs()
+        except FileNotFoundError:
+            return False
+        return inputs == self._path_inputs
+    
+    def process(self, image_path: str, config: ProcessingConfig) -> ProcessingResult:
+        """Like process_image, rerunning only the stages whose inputs changed"""
+        self.rerun = []
+        try:
+            path_inputs = self._image_inputs(image_path) + config.path_inputs()
+            if path_inputs != self._path_inputs:
+                self._path_inputs = None  # stays unset if the stage fails
+                self._path = _pixel_stages(
+                    image_path, self.cache, config.max_points, config.detect_primitives,
+                    config.travel_budget_s, config.trace_graph, config.skeleton_method
+                )
+                self._path_inputs = path_inputs
+                self._angle_inputs = None
+                self.rerun.append("path")
+            
+            path, w, h, path_key = self._path
+            if not path[0]:
+                return failure_result("No drawable content found in image")
+            
+            angle_inputs = config.geometry_inputs()
+            if angle_inputs != self._angle_inputs:
+                if self.cache is None:
+                    self._angles = path_angles(path, w, h, config)
+                else:
+                    self._angles = self.cache.get(
+                        self.cache.key("angles", path_key, *angle_inputs),
+                        lambda: path_angles(path, w, h, config)
+                    )
+                self._angle_inputs = angle_inputs
+                self.rerun.append("angles")
+            
+            return path_result(path, self._angles)
+            
+        except FileNotFoundError as e:
+            return failure_result(str(e))
+        except Exception as e:
+            return failure_result(f"Processing error: {str(e)}")
+
+
+def process_image(
+    image_path: str,
+    config: ProcessingConfig,
+    cache: Optional[StageCache] = None
+) -> ProcessingResult:
+    """
+    Main processing function - takes image path and config, returns angles and laser states.
+    With a cache, only the stages after the first changed input rerun.
+    """
+    return ProcessingSession(cache).process(image_path, config)
@@ -0,0 +1,191 @@
+"""
+Adaptive Resampling for Laser Projector
+Spends a point budget where dropping points would bend the drawing most,
+and simplifies strokes to a tolerance
+"""
+
+import heapq
+from typing import List, Optional, Tuple
+
+import numpy as np
+
+Point = Tuple[float, float]
+Stroke = List[Point]
+
+
+def _furthest(points: np.ndarray, first: int, last: int) -> Tuple[float, int]:
+    """
+    The point strictly between first and last furthest from the segment
+    joining them, and its distance
+    """
+    if last - first < 2:
+        return 0.0, first
+    a = points[first]
+    ab = points[last] - a
+    offset = points[first + 1:last] - a
+    length_sq = ab @ ab
+    if length_sq > 0.0:
+        t = np.minimum(np.maximum(offset @ ab / length_sq, 0.0), 1.0)
+        offset = offset - np.outer(t, ab)
+    dist_sq = (offset * offset).sum(axis=1)
+    index = int(np.argmax(dist_sq))
+    return float(np.sqrt(dist_sq[index])), first + 1 + index
+
+
+def _span_error(points: np.ndarray, first: int, last: int) -> float:
+    """Furthest any point strictly between first and last lies from the segment joining them"""
+    return _furthest(points, first, last)[0]
+
+
+def simplify_stroke(points: np.ndarray, tolerance: float) -> np.ndarray:
+    """
+    Ramer-Douglas-Peucker: which points to keep so that no point lies more
+    than tolerance from the polyline through the kept ones. Both ends stay.
+    """
+    keep = np.zeros(len(points), dtype=bool)
+    if len(points) == 0:
+        return keep
+    keep[[0, -1]] = True
+    spans = [(0, len(points) - 1)]
+    while spans:
+        first, last = spans.pop()
+        dist, index = _furthest(points, first, last)
+        if dist > tolerance:
+            keep[index] = True
+            spans += [(first, index), (index, last)]
+    return keep
+
+
+def _end_error(points: np.ndarray, first: int, last: int, keep: int) -> float:
+    """Furthest any point from first to last lies from point keep, which stands in for them"""
+    return float(np.hypot(*(points[first:last + 1] - points[keep]).T).max())
+
+
+class _Stroke:
+    """Kept points of one stroke as a linked list over its original points"""
+
+    def __init__(self, points: np.ndarray, kept: Optional[np.ndarray] = None):
+        self.points = points
+        n = len(points)
+        self.kept = np.ones(n, dtype=bool) if kept is None else kept
+        indices = np.flatnonzero(self.kept).tolist()
+        self.prev = [-1] * n
+        self.next = [n] * n
+        for before, after in zip(indices[:-1], indices[1:]):
+            self.next[before], self.prev[after] = after, before
+        self.head, self.tail = indices[0], indices[-1]
+        self.dropped_error = 0.0
+
+    def cost(self, i: int) -> float:
+        """How far the drawing would move without point i"""
+        last = len(self.points) - 1
+        if i == self.head and i == self.tail:
+            return _end_error(self.points, 0, last, i)  # the whole stroke goes
+        if self.next[self.head] == self.tail:
+            # A lone point draws nothing, so the last two go together
+            return _end_error(self.points, 0, last, self.tail if i == self.head else self.head)
+        if i == self.head:
+            return _end_error(self.points, 0, self.next[i], self.next[i])
+        if i == self.tail:
+            return _end_error(self.points, self.prev[i], last, self.prev[i])
+        return _span_error(self.points, self.prev[i], self.next[i])
+
+    def remove(self, i: int) -> Tuple[int, List[int]]:
+        """Drop point i, returning how many points went and the kept neighbours whose cost changed"""
+        if i == self.head and i == self.tail or self.next[self.head] == self.tail:
+            self.dropped_error = self.cost(i)
+            self.kept[[self.head, self.tail]] = False
+            return 1 if self.head == self.tail else 2, []
+        before, after = self.prev[i], self.next[i]
+        self.kept[i] = False
+        if i == self.head:
+            self.head = after
+        elif i == self.tail:
+            self.tail = before
+        else:
+            self.next[before], self.prev[after] = after, before
+        return 1, [j for j in (before, after) if self.head <= j <= self.tail]
+
+    def error(self) -> float:
+        """Furthest any original point lies from what is left of the stroke"""
+        if not self.kept.any():
+            return self.dropped_error
+        last = len(self.points) - 1
+        error = max(
+            _end_error(self.points, 0, self.head, self.head),
+            _end_error(self.points, self.tail, last, self.tail)
+        )
+        indices = np.flatnonzero(self.kept)
+        for first, following in zip(indices[:-1], indices[1:]):
+            error = max(error, _span_error(self.points, first, following))
+        return error
+
+
+def _initial_costs(shape: _Stroke) -> np.ndarray:
+    """Stroke.cost for every point while all are kept, in one go"""
+    points = shape.points
+    if len(points) <= 2:
+        return np.array([shape.cost(i) for i in range(len(points))])
+    a, p, b = points[:-2], points[1:-1], points[2:]
+    ab = b - a
+    length_sq = (ab * ab).sum(axis=1)
+    t = np.clip(((p - a) * ab).sum(axis=1) / np.where(length_sq > 0, length_sq, 1.0), 0.0, 1.0)
+    inner = np.hypot(*(p - a - t[:, None] * ab).T)
+    ends = np.hypot(*(points[[0, -1]] - points[[1, -2]]).T)
+    return np.concatenate(([ends[0]], inner, [ends[1]]))
+
+
+def simplify_strokes(
+    strokes: List[Stroke],
+    tolerance: float,
+    scale: Tuple[float, float] = (1.0, 1.0)
+) -> Tuple[List[Stroke], float]:
+    """
+    Every stroke cut down with simplify_stroke, and the worst distance from
+    one of its points to the stroke as drawn. Distances are measured with x
+    and y multiplied by scale; the points kept are the original ones.
+    """
+    result, error = [], 0.0
+    for stroke in strokes:
+        points = np.asarray(stroke, dtype=float).reshape(-1, 2) * scale
+        shape = _Stroke(points, simplify_stroke(points, tolerance))
+        result.append([stroke[i] for i in np.flatnonzero(shape.kept)])
+        error = max(error, shape.error())
+    return result, error
+
+
+def resample_strokes(strokes: List[Stroke], budget: int) -> Tuple[List[Stroke], float]:
+    """
+    Drop points, cheapest first, until the strokes hold at most `budget`
+    points in total. A point costs the distance the drawing would move
+    without it: the furthest original point from the segment that replaces
+    it, or, for the end of a stroke, from the new end. Straight runs go
+    first and tight curves keep their points; when the budget is too small
+    for every stroke, short strokes shrink and then go. Returns the
+    strokes left, in order, and the worst distance from an original point
+    to its stroke as drawn.
+    """
+    shapes = [_Stroke(np.asarray(stroke, dtype=float).reshape(-1, 2)) for stroke in strokes]
+    cost = [_initial_costs(shape) for shape in shapes]
+    heap = [(value, s, i) for s, values in enumerate(cost) for i, value in enumerate(values.tolist())]
+    heapq.heapify(heap)
+
+    kept = len(heap)  # one entry per kept point so far
+    while kept > budget and heap:
+        value, s, i = heapq.heappop(heap)
+        shape = shapes[s]
+        if not shape.kept[i] or value != cost[s][i]:
+            continue  # taken already, or re-queued with a new cost
+        count, changed = shape.remove(i)
+        kept -= count
+        # The neighbours now stand in for more points, so dropping them costs more
+        for j in changed:
+            cost[s][j] = shape.cost(j)
+            heapq.heappush(heap, (cost[s][j], s, j))
+
+    result = [
+        [strokes[s][i] for i in np.flatnonzero(shape.kept)]
+        for s, shape in enumerate(shapes) if shape.kept.any()
+    ]
+    error = max((shape.error() for shape in shapes), default=0.0)
+    return result, error
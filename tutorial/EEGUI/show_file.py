@@ -0,0 +1,73 @@
+"""
+Binary Show File Writer for Laser Projector
+Writes point data for the sketch's SD card streaming mode
+"""
+
+import struct
+from pathlib import Path
+from typing import List, Optional
+
+from cpp_generator import (
+    PLAYBACK_MODES, assign_detail_levels, encode_records, plan_playback
+)
+
+
+BLOCK_SIZE = 512
+MAGIC = b"EELS"
+VERSION = 1
+MAX_DETAIL_LEVELS = 8
+
+
+def build_show_file(
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    playback: str = "auto",
+    detail_levels: int = 1,
+    wall_distance: Optional[float] = None
+) -> bytes:
+    """
+    Build the file image: a header block followed by the two-word point
+    records (same layout as the flash pattern bank), padded to whole blocks.
+    Pass wall_distance (meters) for a sketch built with wall_space.
+    """
+    if not 1 <= detail_levels <= MAX_DETAIL_LEVELS:
+        raise ValueError(f"detail_levels must be between 1 and {MAX_DETAIL_LEVELS}")
+    
+    plan = plan_playback(x_angles, y_angles, laser_states, playback)
+    levels = assign_detail_levels(plan.x_angles, plan.y_angles, plan.laser_states, detail_levels)
+    records = encode_records(plan.x_angles, plan.y_angles, plan.laser_states, levels, wall_distance)
+    
+    point_count = len(records) // 2
+    level_counts = [
+        sum(1 for lv in levels if lv <= level) for level in range(MAX_DETAIL_LEVELS)
+    ]
+    
+    header = MAGIC + struct.pack(
+        "<BBBBI8I",
+        VERSION, PLAYBACK_MODES[plan.mode], detail_levels, 0,
+        point_count, *level_counts
+    )
+    header = header.ljust(BLOCK_SIZE, b"\0")
+    
+    body = struct.pack(f"<{len(records)}H", *records)
+    padding = (-len(body)) % BLOCK_SIZE
+    return header + body + b"\0" * padding
+
+
+def save_show_file(
+    output_path: str,
+    x_angles: List[float],
+    y_angles: List[float],
+    laser_states: List[bool],
+    playback: str = "auto",
+    detail_levels: int = 1,
+    wall_distance: Optional[float] = None
+) -> str:
+    """Write SHOW.BIN style file for the SD card, returns the path"""
+    data = build_show_file(x_angles, y_angles, laser_states, playback, detail_levels, wall_distance)
+    
+    path = Path(output_path)
+    path.write_bytes(data)
+    
+    return str(path.absolute())
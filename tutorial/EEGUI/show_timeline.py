@@ -0,0 +1,74 @@
+"""
+Show Timeline Compiler for Laser Projector
+Turns a list of images into one sketch that plays them as a timed show
+"""
+
+from dataclasses import dataclass
+from pathlib import Path
+from typing import List
+
+from cpp_generator import Cue, Pattern, generate_bank_cpp
+from processor import ProcessingConfig, process_image
+
+
+@dataclass
+class Scene:
+    """One image of the show and how long it stays up (see Cue)"""
+    image_path: str
+    frames: int = 1
+    duration_ms: int = 0
+    blank_ms: int = 0
+
+
+def compile_show(
+    scenes: List[Scene],
+    config: ProcessingConfig,
+    **options
+) -> str:
+    """
+    Process every distinct image once, store them as a pattern bank and
+    generate the timeline that sequences them. options go to generate_bank_cpp()
+    """
+    if not scenes:
+        raise ValueError("A show needs at least one scene")
+    
+    patterns = []
+    pattern_index = {}
+    timeline = []
+    for scene in scenes:
+        key = str(Path(scene.image_path).resolve())
+        if key not in pattern_index:
+            result = process_image(scene.image_path, config)
+            if not result.success:
+                raise ValueError(f"{scene.image_path}: {result.message}")
+            pattern_index[key] = len(patterns)
+            patterns.append(Pattern(
+                Path(scene.image_path).name,
+                result.x_angles, result.y_angles, result.laser_states
+            ))
+        timeline.append(Cue(
+            pattern_index[key], scene.frames, scene.duration_ms, scene.blank_ms
+        ))
+    
+    return generate_bank_cpp(
+        patterns,
+        config.wall_distance_meters,
+        config.projected_size_meters,
+        timeline=timeline,
+        **options
+    )
+
+
+def save_show_cpp(
+    output_path: str,
+    scenes: List[Scene],
+    config: ProcessingConfig,
+    **options
+) -> str:
+    """Compile the show and save the sketch, returns the path"""
+    cpp_code = compile_show(scenes, config, **options)
+    
+    path = Path(output_path)
+    path.write_text(cpp_code)
+    
+    return str(path.absolute())
@@ -0,0 +1,162 @@
+"""
+Skeleton Graph Tracing for Laser Projector
+Walks an 8-connected skeleton into strokes between endpoints and junctions
+"""
+
+import cv2
+import numpy as np
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+NEIGHBOURS = (  # 4-connected first, so walks take the straight step
+    (-1, 0), (0, 1), (1, 0), (0, -1),
+    (-1, 1), (1, 1), (1, -1), (-1, -1)
+)
+
+
+@dataclass
+class GraphNode:
+    """An endpoint (one pixel) or a junction (touching pixels with 3+ neighbours)"""
+    kind: str
+    pixels: List[Tuple[int, int]]  # (x, y)
+
+
+@dataclass
+class GraphStroke:
+    """
+    Pixels (x, y) in walking order from one node to another, or around a
+    closed loop with no nodes (start and end are None, first pixel repeated
+    at the end)
+    """
+    pixels: List[Tuple[int, int]]
+    start: Optional[int] = None
+    end: Optional[int] = None
+
+
+@dataclass
+class SkeletonGraph:
+    nodes: List[GraphNode] = field(default_factory=list)
+    strokes: List[GraphStroke] = field(default_factory=list)
+
+
+RING = ((-1, 0), (-1, 1), (0, 1), (1, 1), (1, 0), (1, -1), (0, -1), (-1, -1))  # N clockwise
+
+
+def _ring_components(ring: List[bool]) -> int:
+    """8-connected groups among the neighbours of a pixel, the pixel itself left out"""
+    ring = list(ring)
+    for corner in (1, 3, 5, 7):
+        # Two edge neighbours touch diagonally even without the corner between them
+        if ring[corner - 1] and ring[(corner + 1) % 8]:
+            ring[corner] = True
+    if all(ring):
+        return 1
+    return sum(1 for i in range(8) if ring[i] and not ring[i - 1])
+
+
+def _remove_redundant(mask: np.ndarray) -> np.ndarray:
+    """
+    Drop pixels whose neighbours stay connected without them, like the
+    corners of 8-connected staircases and the doubled pixels of thick
+    diagonals, which would otherwise look like junctions. One pixel at a
+    time, so connectivity is checked against what is left; endpoints stay.
+    """
+    mask = mask.copy()
+    h, w = mask.shape
+    padded = np.pad(mask, 1)
+    for y, x in zip(*np.nonzero(mask)):
+        ring = [bool(padded[1 + y + dy, 1 + x + dx]) for dy, dx in RING]
+        if sum(ring) >= 2 and _ring_components(ring) == 1:
+            mask[y, x] = False
+            padded[1 + y, 1 + x] = False
+    return mask
+
+
+def trace_skeleton(skel: np.ndarray) -> SkeletonGraph:
+    """
+    Split a skeleton image (non-zero = ink) into strokes that run between
+    endpoints and junctions. Every pixel is walked once, so this is linear
+    in the skeleton size; isolated pixels become one-pixel strokes.
+    """
+    mask = _remove_redundant(skel > 0)
+    h, w = mask.shape
+    degree = cv2.filter2D(mask.astype(np.uint8), -1, np.ones((3, 3), np.float32),
+                          borderType=cv2.BORDER_CONSTANT) - mask
+
+    # Touching junction pixels are one junction; endpoints stand alone
+    node_mask = mask & (degree != 2)
+    node_id = np.full(mask.shape, -1, dtype=np.int32)
+    graph = SkeletonGraph()
+    junctions = (mask & (degree >= 3)).astype(np.uint8)
+    count, labels = cv2.connectedComponents(junctions, connectivity=8)
+    for label in range(1, count):
+        ys, xs = np.nonzero(labels == label)
+        node_id[ys, xs] = len(graph.nodes)
+        graph.nodes.append(GraphNode("junction", list(zip(xs.tolist(), ys.tolist()))))
+    for y, x in zip(*np.nonzero(mask & (degree <= 1))):
+        node_id[y, x] = len(graph.nodes)
+        graph.nodes.append(GraphNode("end", [(int(x), int(y))]))
+        if degree[y, x] == 0:
+            graph.strokes.append(GraphStroke([(int(x), int(y))], node_id[y, x], node_id[y, x]))
+
+    visited = node_mask.copy()
+    linked: Dict[Tuple[int, int], bool] = {}
+
+    def neighbours(y: int, x: int):
+        for dy, dx in NEIGHBOURS:
+            ny, nx = y + dy, x + dx
+            if 0 <= ny < h and 0 <= nx < w and mask[ny, nx]:
+                yield ny, nx
+
+    def walk(start: Tuple[int, int], first: Tuple[int, int], home: int) -> GraphStroke:
+        """Follow degree-2 pixels from `first` until a node or a dead end"""
+        path = [start, first]
+        visited[first] = True
+        y, x = first
+        while True:
+            step = None
+            for ny, nx in neighbours(y, x):
+                if (ny, nx) == path[-2] or (len(path) == 2 and node_id[ny, nx] == home >= 0):
+                    continue
+                if node_id[ny, nx] >= 0:
+                    step = (ny, nx)  # arriving at a node ends the stroke
+                    break
+                if not visited[ny, nx] and step is None:
+                    step = (ny, nx)
+            if step is None:
+                end = None
+                break
+            path.append(step)
+            if node_id[step] >= 0:
+                end = int(node_id[step])
+                break
+            visited[step] = True
+            y, x = step
+        return GraphStroke([(px, py) for py, px in path], home if home >= 0 else None, end)
+
+    for index, node in enumerate(graph.nodes):
+        for x, y in node.pixels:
+            for ny, nx in neighbours(y, x):
+                other = int(node_id[ny, nx])
+                if other == index:
+                    continue
+                if other >= 0:
+                    # Two nodes side by side: a one-step stroke, traced once
+                    key = tuple(sorted(((y, x), (ny, nx))))
+                    if key not in linked:
+                        linked[key] = True
+                        graph.strokes.append(GraphStroke([(x, y), (nx, ny)], index, other))
+                elif not visited[ny, nx]:
+                    graph.strokes.append(walk((y, x), (ny, nx), index))
+
+    # Whatever is left are closed loops without endpoints or junctions
+    for y, x in zip(*np.nonzero(mask & ~visited)):
+        if visited[y, x]:
+            continue
+        y, x = int(y), int(x)
+        visited[y, x] = True
+        loop = walk((y, x), next(neighbours(y, x)), -1)
+        loop.pixels.append((x, y))
+        graph.strokes.append(loop)
+
+    return graph
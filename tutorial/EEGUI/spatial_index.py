@@ -0,0 +1,93 @@
+"""
+Spatial Index for Laser Projector
+Uniform grid over skeleton pixels with removal, for nearest neighbour ordering
+"""
+
+from typing import List, Tuple
+
+import numpy as np
+
+CELL_SIZE = 4  # pixels per grid cell side
+
+
+class PointGrid:
+    """
+    Buckets points into square cells so a nearest neighbour query only looks
+    at the cells around the query point, ring by ring, instead of every
+    point left. Points are removed as they are taken.
+    """
+
+    def __init__(self, points: np.ndarray, cell_size: int = CELL_SIZE):
+        self.points = np.asarray(points, dtype=float)
+        self.cell_size = cell_size
+        self.remaining = len(self.points)
+        if self.remaining == 0:
+            self.origin = np.zeros(2)
+            self.shape = (0, 0)
+            self.cells: List[List[int]] = []
+            return
+
+        self.origin = self.points.min(axis=0)
+        coords = ((self.points - self.origin) // cell_size).astype(int)
+        self.shape = tuple(int(v) + 1 for v in coords.max(axis=0))
+        self.cells = [[] for _ in range(self.shape[0] * self.shape[1])]
+        for index, (row, col) in enumerate(coords.tolist()):
+            self.cells[row * self.shape[1] + col].append(index)
+        # Plain floats, numpy scalars are slow in the per-point loop
+        self._coords = self.points.tolist()
+
+    def _cell_of(self, point) -> Tuple[int, int]:
+        return (
+            int((point[0] - self.origin[0]) // self.cell_size),
+            int((point[1] - self.origin[1]) // self.cell_size)
+        )
+
+    def _ring(self, row: int, col: int, radius: int):
+        """Cells exactly `radius` cells away (Chebyshev), clipped to the grid"""
+        rows, cols = self.shape
+        top, bottom = row - radius, row + radius
+        left, right = max(col - radius, 0), min(col + radius, cols - 1)
+        for r in (top, bottom) if radius else (top,):
+            if 0 <= r < rows:
+                for c in range(left, right + 1):
+                    yield self.cells[r * cols + c]
+        if radius == 0:
+            return
+        for r in range(max(top + 1, 0), min(bottom, rows)):
+            for c in (col - radius, col + radius):
+                if 0 <= c < cols:
+                    yield self.cells[r * cols + c]
+
+    def pop_nearest(self, point: np.ndarray) -> Tuple[int, float]:
+        """
+        Remove and return the index of the point closest to `point` and its
+        squared distance. Ties go to the lowest index, like np.argmin over
+        the points in order.
+        """
+        if self.remaining == 0:
+            raise IndexError("pop from an empty PointGrid")
+
+        px, py = float(point[0]), float(point[1])
+        row, col = self._cell_of((px, py))
+        max_radius = max(
+            row, col, self.shape[0] - 1 - row, self.shape[1] - 1 - col
+        )
+        coords = self._coords
+        best = (float("inf"), -1)
+        for radius in range(max_radius + 1):
+            for cell in self._ring(row, col, radius):
+                for index in cell:
+                    x, y = coords[index]
+                    candidate = ((x - px) * (x - px) + (y - py) * (y - py), index)
+                    if candidate < best:
+                        best = candidate
+            # Anything in the next ring is at least radius cells away
+            reach = radius * self.cell_size
+            if best[1] >= 0 and best[0] < reach * reach:
+                break
+
+        dist_sq, index = best
+        cell_row, cell_col = self._cell_of(coords[index])
+        self.cells[cell_row * self.shape[1] + cell_col].remove(index)
+        self.remaining -= 1
+        return index, dist_sq
@@ -0,0 +1,116 @@
+"""
+Stage Cache for Laser Projector
+On-disk results of pipeline stages, keyed by their inputs' content
+"""
+
+import hashlib
+import os
+import pickle
+import tempfile
+from pathlib import Path
+from typing import Any, Callable, Optional
+
+CACHE_VERSION = 2  # bump when a stage's output changes for the same inputs
+DEFAULT_DIRECTORY = Path.home() / ".cache" / "eegui"
+MAX_CACHE_BYTES = 512 << 20  # least recently used entries go beyond this
+PRUNE_INTERVAL = 100  # stores between two size checks
+
+
+class StageCache:
+    """
+    Pickled stage outputs in one file per key. A stage's key hashes the key
+    of the stage it reads from plus its own parameters, so changing one
+    parameter only misses the stages from there on, and the same image
+    under another name still hits. Reading an entry marks it used, and
+    every PRUNE_INTERVAL stores the least recently used entries go until
+    the cache fits in max_bytes.
+    """
+
+    def __init__(self, directory: Optional[Path] = None, max_bytes: int = MAX_CACHE_BYTES):
+        self.directory = Path(directory or os.environ.get("EEGUI_CACHE", DEFAULT_DIRECTORY))
+        self.max_bytes = max_bytes
+        self.hits = 0
+        self.misses = 0
+
+    @staticmethod
+    def key(stage: str, *parts: Any) -> str:
+        """Key of a stage from its upstream key and parameters (repr must be stable)"""
+        text = repr((CACHE_VERSION, stage) + parts)
+        return hashlib.sha256(text.encode()).hexdigest()
+
+    @staticmethod
+    def file_key(path: str) -> str:
+        """Key of a file's bytes"""
+        digest = hashlib.sha256()
+        with open(path, "rb") as f:
+            for block in iter(lambda: f.read(1 << 20), b""):
+                digest.update(block)
+        return digest.hexdigest()
+
+    def _path(self, key: str) -> Path:
+        return self.directory / key[:2] / f"{key}.pkl"
+
+    def get(self, key: str, compute: Callable[[], Any]) -> Any:
+        """The stored value for key, or compute() stored under it"""
+        path = self._path(key)
+        try:
+            with open(path, "rb") as f:
+                value = pickle.load(f)
+        except FileNotFoundError:
+            pass
+        except Exception:
+            # Damaged, or pickled by code that has changed since: recompute
+            path.unlink(missing_ok=True)
+        else:
+            self.hits += 1
+            try:
+                os.utime(path)
+            except OSError:
+                pass  # pruned meanwhile by another process
+            return value
+
+        self.misses += 1
+        value = compute()
+        try:
+            path.parent.mkdir(parents=True, exist_ok=True)
+            # Write aside and rename, so a reader never sees half a file
+            fd, temp = tempfile.mkstemp(dir=path.parent, suffix=".tmp")
+            try:
+                with os.fdopen(fd, "wb") as f:
+                    pickle.dump(value, f, protocol=pickle.HIGHEST_PROTOCOL)
+                os.replace(temp, path)
+            except OSError:
+                os.unlink(temp)
+                raise
+        except OSError:
+            pass  # a read-only or full disk only costs the speedup
+        if self.misses % PRUNE_INTERVAL == 0:
+            self.prune()
+        return value
+
+    def prune(self) -> None:
+        """Delete the least recently used entries until the rest fit in max_bytes"""
+        entries = []
+        for path in self.directory.glob("*/*.pkl"):
+            try:
+                stat = path.stat()
+            except OSError:
+                continue
+            entries.append((stat.st_mtime, stat.st_size, path))
+        total = sum(size for _, size, _ in entries)
+        for _, size, path in sorted(entries, key=lambda entry: entry[0]):
+            if total <= self.max_bytes:
+                break
+            try:
+                path.unlink()
+            except OSError:
+                continue
+            total -= size
+
+    def clear(self) -> None:
+        """Delete every entry (only the entries: the directory may be shared)"""
+        for path in self.directory.glob("*/*.pkl"):
+            try:
+                path.unlink()
+            except OSError:
+                pass
@@ -0,0 +1,213 @@
+"""
+Stroke Ordering for Laser Projector
+Orders and orients lit strokes to cut the blanked travel between them
+"""
+
+import time
+from typing import List, Optional, Tuple
+
+import numpy as np
+
+Point = Tuple[float, float]
+Stroke = List[Point]
+
+OR_OPT_LENGTHS = (1, 2, 3)  # strokes moved together by one Or-opt move
+MAX_OPT_PASSES = 10  # rounds of 2-opt and Or-opt, most tours settle in under 8
+
+
+def blanked_travel(strokes: List[Stroke]) -> float:
+    """
+    Length of the blanked moves between strokes in play order, including
+    the jump from the last stroke back to the first as the frame repeats
+    """
+    if len(strokes) < 2:
+        return 0.0
+    ends = np.array([stroke[-1] for stroke in strokes], dtype=float)
+    starts = np.array([stroke[0] for stroke in strokes], dtype=float)
+    return float(np.hypot(*(np.roll(starts, -1, axis=0) - ends).T).sum())
+
+
+def greedy_order(strokes: List[Stroke]) -> List[Stroke]:
+    """Chain strokes nearest end first from the first one, reversing any that are closer backwards"""
+    starts = np.array([stroke[0] for stroke in strokes], dtype=float)
+    ends = np.array([stroke[-1] for stroke in strokes], dtype=float)
+    remaining = np.ones(len(strokes), dtype=bool)
+
+    ordered = []
+    index, reverse = 0, False
+    while True:
+        remaining[index] = False
+        stroke = strokes[index][::-1] if reverse else strokes[index]
+        ordered.append(stroke)
+        if not remaining.any():
+            return ordered
+        current = np.array(stroke[-1], dtype=float)
+        to_start = np.where(remaining, ((starts - current) ** 2).sum(axis=1), np.inf)
+        to_end = np.where(remaining, ((ends - current) ** 2).sum(axis=1), np.inf)
+        forward, backward = int(np.argmin(to_start)), int(np.argmin(to_end))
+        if to_end[backward] < to_start[forward]:
+            index, reverse = backward, True
+        else:
+            index, reverse = forward, False
+
+
+class _Tour:
+    """Closed tour of oriented strokes: entry and exit point per position"""
+
+    def __init__(self, strokes: List[Stroke]):
+        self._rebuild(strokes)
+
+    def _rebuild(self, strokes: List[Stroke]) -> None:
+        """Take strokes as the whole tour, in play order"""
+        self.strokes = list(strokes)
+        self.entry = np.array([stroke[0] for stroke in strokes], dtype=float)
+        self.exit = np.array([stroke[-1] for stroke in strokes], dtype=float)
+
+    def reverse(self, i: int, j: int) -> None:
+        """Play positions i..j in the opposite order and direction"""
+        self.strokes[i:j + 1] = [stroke[::-1] for stroke in reversed(self.strokes[i:j + 1])]
+        entry = self.entry[i:j + 1][::-1].copy()
+        self.entry[i:j + 1] = self.exit[i:j + 1][::-1]
+        self.exit[i:j + 1] = entry
+
+    def two_opt(self, deadline: float) -> bool:
+        """One pass of segment reversals; position 0 stays put. True if any helped"""
+        m = len(self.strokes)
+        improved = False
+        for i in range(1, m):
+            if time.monotonic() > deadline:
+                break
+            j = np.arange(i, m)
+            a, b = self.exit[i - 1], self.entry[i]
+            c, d = self.exit[j], self.entry[(j + 1) % m]
+            delta = (
+                np.hypot(*(c - a).T) + np.hypot(*(d - b).T)
+                - np.hypot(*(b - a)) - np.hypot(*(d - c).T)
+            )
+            best = int(np.argmin(delta))
+            if delta[best] < -1e-9:
+                self.reverse(i, i + best)
+                improved = True
+        return improved
+
+    def or_opt(self, deadline: float) -> bool:
+        """One pass moving runs of 1-3 strokes elsewhere, either way round"""
+        m = len(self.strokes)
+        improved = False
+        for length in OR_OPT_LENGTHS:
+            i = 1
+            while i + length <= m:
+                if time.monotonic() > deadline:
+                    return improved
+                last = i + length - 1
+                prev, first_in = self.exit[i - 1], self.entry[i]
+                last_out, following = self.exit[last], self.entry[(last + 1) % m]
+                gain = (
+                    np.hypot(*(first_in - prev)) + np.hypot(*(following - last_out))
+                    - np.hypot(*(following - prev))
+                )
+                # Insert between p and p + 1, for every p not touching the run
+                p = np.concatenate((np.arange(0, i - 1), np.arange(last + 1, m)))
+                if len(p) == 0 or gain <= 1e-9:
+                    i += 1
+                    continue
+                u, v = self.exit[p], self.entry[(p + 1) % m]
+                gap = np.hypot(*(v - u).T)
+                forward = np.hypot(*(first_in - u).T) + np.hypot(*(v - last_out).T) - gap
+                backward = np.hypot(*(last_out - u).T) + np.hypot(*(v - first_in).T) - gap
+                cost = np.minimum(forward, backward)
+                best = int(np.argmin(cost))
+                if cost[best] < gain - 1e-9:
+                    self._move(i, last, int(p[best]), bool(backward[best] < forward[best]))
+                    improved = True
+                else:
+                    i += 1
+        return improved
+
+    def _move(self, i: int, last: int, after: int, reverse: bool) -> None:
+        run = self.strokes[i:last + 1]
+        if reverse:
+            run = [stroke[::-1] for stroke in reversed(run)]
+        rest = self.strokes[:i] + self.strokes[last + 1:]
+        at = after + 1 if after < i else after - len(run) + 1
+        self._rebuild(rest[:at] + run + rest[at:])
+
+
+def follow_reference(strokes: List[Stroke], reference: List[Stroke]) -> List[Stroke]:
+    """
+    Order strokes like the reference strokes nearest their midpoints, each
+    running the same way as its match, so a frame starts out in the order
+    of the one before it
+    """
+    if not strokes or not reference:
+        return list(strokes)
+    middles = np.array([stroke[len(stroke) // 2] for stroke in strokes], dtype=float)
+    ref_middles = np.array([stroke[len(stroke) // 2] for stroke in reference], dtype=float)
+    distance = np.hypot(*(middles[:, None, :] - ref_middles[None, :, :]).transpose(2, 0, 1))
+    match = distance.argmin(axis=1)
+
+    ordered = []
+    for index in sorted(range(len(strokes)), key=lambda i: (match[i], distance[i, match[i]])):
+        stroke, ref_start = strokes[index], reference[match[index]][0]
+        backwards = np.hypot(*np.subtract(stroke[-1], ref_start)) < np.hypot(*np.subtract(stroke[0], ref_start))
+        ordered.append(stroke[::-1] if backwards else stroke)
+    return ordered
+
+
+def align_tour(strokes: List[Stroke], reference: List[Stroke]) -> List[Stroke]:
+    """
+    Rotate the closed tour, and turn it around if that matches better, so
+    it starts where the reference starts and heads the same way. Neither
+    changes blanked_travel.
+    """
+    if len(strokes) < 2 or not reference:
+        return list(strokes)
+    target = np.array(reference[0][0], dtype=float)
+    best, best_score = list(strokes), float("inf")
+    for tour in (strokes, [stroke[::-1] for stroke in reversed(strokes)]):
+        starts = np.array([stroke[0] for stroke in tour], dtype=float)
+        r = int(np.argmin(np.hypot(*(starts - target).T)))
+        rotated = tour[r:] + tour[:r]
+        score = np.hypot(*(starts[r] - target))
+        if len(reference) > 1:
+            score += np.hypot(*np.subtract(rotated[1][0], reference[1][0]))
+        if score < best_score:
+            best, best_score = rotated, score
+    return best
+
+
+def optimize_stroke_order(
+    strokes: List[Stroke],
+    time_budget_s: float = 2.0,
+    reference: Optional[List[Stroke]] = None
+) -> Tuple[List[Stroke], float, float]:
+    """
+    Reorder and flip strokes to shorten the blanked travel: the better of
+    the given order and a greedy chain, then up to MAX_OPT_PASSES rounds of
+    2-opt and Or-opt until nothing improves. The same strokes always give
+    the same order; the time budget only cuts short a tour too big to
+    finish in it. Returns the strokes in play order and the travel (see
+    blanked_travel) before and after.
+    With the previous frame's strokes as reference, the search starts from
+    its order and the result starts where it started (see align_tour).
+    """
+    before = blanked_travel(strokes)
+    if reference:
+        strokes = follow_reference(strokes, reference)
+    if len(strokes) < 3 or time_budget_s <= 0:
+        strokes = align_tour(strokes, reference) if reference else list(strokes)
+        return strokes, before, blanked_travel(strokes)
+
+    deadline = time.monotonic() + time_budget_s
+    greedy = greedy_order(strokes)
+    tour = _Tour(greedy if blanked_travel(greedy) < blanked_travel(strokes) else strokes)
+    for _ in range(MAX_OPT_PASSES):
+        if time.monotonic() > deadline:
+            break
+        improved = tour.two_opt(deadline)
+        improved = tour.or_opt(deadline) or improved
+        if not improved:
+            break
+
+    strokes = align_tour(tour.strokes, reference) if reference else tour.strokes
+    return strokes, before, blanked_travel(strokes)
@@ -0,0 +1,70 @@
+"""
+Tests for animation.py
+Run from tutorial/EEGUI: python -m unittest discover tests
+"""
+
+import shutil
+import tempfile
+import unittest
+from pathlib import Path
+
+import cv2
+import numpy as np
+
+from animation import process_animation
+from processor import ProcessingConfig
+from stage_cache import StageCache
+
+
+class ProcessAnimationTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(tempfile.mkdtemp(prefix="eegui_animation_"))
+        self.video = str(self.directory / "rings.avi")
+        writer = cv2.VideoWriter(self.video, cv2.VideoWriter_fourcc(*"MJPG"), 10, (160, 160))
+        if not writer.isOpened():
+            self.skipTest("no MJPG writer")
+        # Three growing rings, the last one shown twice
+        for radius in (20, 35, 50, 50):
+            frame = np.full((160, 160, 3), 255, np.uint8)
+            cv2.circle(frame, (80, 80), radius, (0, 0, 0), 3)
+            writer.write(frame)
+        writer.release()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def test_repeated_frame_is_drawn_once(self):
+        result = process_animation(self.video, ProcessingConfig(max_points=60))
+        self.assertTrue(result.success, result.message)
+        self.assertEqual(len(result.frames), 3)
+        self.assertEqual(result.sequence, [0, 1, 2, 2])
+
+    def test_frames_go_through_the_stage_cache(self):
+        config = ProcessingConfig(max_points=60)
+        plain = process_animation(self.video, config)
+        cache = StageCache(self.directory / "cache")
+        first = process_animation(self.video, config, cache=cache)
+        self.assertEqual((cache.hits, cache.misses), (0, 9))  # skeleton, path and angles of 3 frames
+        self.assertEqual([f.x_angles for f in first.frames], [f.x_angles for f in plain.frames])
+
+        cache = StageCache(self.directory / "cache")
+        again = process_animation(self.video, config, cache=cache)
+        self.assertEqual((cache.hits, cache.misses), (6, 0))
+        self.assertEqual([f.laser_states for f in again.frames], [f.laser_states for f in first.frames])
+
+        # Geometry only reaches the angles
+        cache = StageCache(self.directory / "cache")
+        process_animation(self.video, ProcessingConfig(max_points=60, wall_distance_meters=2.5), cache=cache)
+        self.assertEqual((cache.hits, cache.misses), (3, 3))
+
+    def test_coherent_paths_depend_on_the_frame_before(self):
+        cache = StageCache(self.directory / "cache")
+        process_animation(self.video, ProcessingConfig(max_points=60), cache=cache)
+        cache = StageCache(self.directory / "cache")
+        process_animation(self.video, ProcessingConfig(max_points=60), coherent=False, cache=cache)
+        # The first frame has nothing before it; the others are traced afresh from their skeletons
+        self.assertEqual((cache.hits, cache.misses), (4, 4))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,176 @@
+"""
+Tests for cpp_generator.py
+Run from tutorial/EEGUI: python -m unittest discover tests
+"""
+
+import random
+import re
+import unittest
+
+from cpp_generator import (
+    Pattern, Shape, _player_steps, assign_detail_levels, encode_records, generate_bank_cpp, generate_cpp,
+    plan_playback, playback_moves, shape_plan, simulate_microstep_switching, step_resolution
+)
+
+STEPS_PER_DEGREE = 200 * 0.25 / 360.0  # the generator's defaults
+
+
+class StepRoundingTest(unittest.TestCase):
+    def test_constant_angle_lands_on_one_step(self):
+        # 45 deg is 6.25 steps: a carried remainder would alternate 6 and 7
+        self.assertEqual(_player_steps([45.0] * 8, STEPS_PER_DEGREE), [6] * 8)
+
+    def test_rounds_to_nearest_step(self):
+        angles = [i * 0.37 for i in range(300)]
+        for angle, steps in zip(angles, _player_steps(angles, STEPS_PER_DEGREE)):
+            self.assertLessEqual(abs(steps - angle * STEPS_PER_DEGREE), 0.5 + 1e-9)
+
+    def test_resolution_reports_error_and_repeatability(self):
+        xs = [5.0, 45.0, 45.0, 80.0, 45.0]
+        ys = [45.0, 45.0, 30.5, 45.0, 45.0]
+        resolution = step_resolution(xs, ys, 1.6)
+        self.assertLessEqual(resolution.rounded_error, 0.5)
+        self.assertGreater(resolution.truncated_error, resolution.rounded_error)
+        self.assertEqual(resolution.collapsed, 0)
+        self.assertEqual(resolution.point_count, 5)
+
+    def test_resolution_counts_points_merged_onto_one_step(self):
+        # 7.2 deg per step: the first three land on step 1, the repeat is not counted
+        xs = [7.0, 7.5, 8.0, 7.0, 30.0]
+        ys = [10.0, 10.0, 10.0, 10.0, 10.0]
+        resolution = step_resolution(xs, ys, 1.6)
+        self.assertEqual(resolution.collapsed, 2)
+        self.assertIn("2/5 points merge", resolution.summary())
+
+
+class MicrostepSwitchingTest(unittest.TestCase):
+    def setUp(self):
+        rng = random.Random(1)
+        xs = [float(rng.randint(-50, 400)) for _ in range(300)]
+        ys = [float(rng.randint(-50, 400)) for _ in range(300)]
+        laser = [rng.random() < 0.5 for _ in range(300)]
+        self.plan = plan_playback(xs, ys, laser, "loop")
+
+    def test_positions_survive_every_switch(self):
+        plan = simulate_microstep_switching(self.plan, 1.0, 8, 32)
+        self.assertGreater(plan.jump_count, 0)
+        self.assertLess(plan.jump_pulses, plan.draw_pulses)
+
+    def test_catches_wrong_scale_factor(self):
+        # The driver moves 8 drawing steps per jump pulse, the sketch assumes 4 or 16
+        for sketch_ratio in (4, 16):
+            with self.assertRaises(ValueError):
+                simulate_microstep_switching(self.plan, 1.0, sketch_ratio, 32, driver_ratio=8)
+        with self.assertRaises(ValueError):
+            simulate_microstep_switching(self.plan, 1.0, 8, 32, driver_ratio=4)
+
+    def test_short_and_lit_moves_never_switch(self):
+        plan = plan_playback([60.0, 100.0, 50.0], [40.0, 41.0, 42.0], [False, True, True], "loop")
+        replay = simulate_microstep_switching(plan, 1.0, 8, 32)
+        self.assertEqual(replay.jump_count, 0)
+        self.assertEqual(replay.jump_pulses, replay.draw_pulses)
+
+    def test_follows_the_moves_the_sketch_plays(self):
+        # Every point is lit, but the travel onto point 0 after a restart is blanked
+        line = plan_playback([100.0, 140.0, 180.0], [100.0, 100.0, 100.0], [True] * 3, "loop")
+        self.assertEqual(simulate_microstep_switching(line, 1.0, 8, 32, frames=3).jump_count, 3)
+        # A WRAP seam stays lit: only the entry jumps
+        diamond = plan_playback([100.0, 140.0, 180.0, 140.0], [100.0, 130.0, 100.0, 70.0], [True] * 4, "wrap")
+        self.assertTrue(diamond.laser_states[0])
+        self.assertEqual(simulate_microstep_switching(diamond, 1.0, 8, 32, frames=3).jump_count, 1)
+
+    def test_generator_runs_the_replay(self):
+        code = generate_cpp(
+            [30.0, 60.0, 45.0, 31.0], [30.0, 40.0, 50.0, 33.0], [True, False, True, False],
+            1.6, 1.5, microsteps=16, jump_microsteps=2
+        )
+        self.assertIn("#define JUMP_STEP_RATIO 8", code)
+        self.assertIn("Microstep switching: 16x draw / 2x jump |", code)
+
+
+class PlaybackEntryTest(unittest.TestCase):
+    SQUARE = ([10.0, 20.0, 20.0, 10.0], [10.0, 10.0, 20.0, 20.0], [True] * 4)
+
+    def test_wrap_enters_dark_and_keeps_the_seam_lit(self):
+        plan = plan_playback(*self.SQUARE)
+        self.assertEqual(plan.mode, "wrap")
+        self.assertTrue(plan.laser_states[0])  # the seam is drawn...
+        moves = playback_moves(plan, frames=2)
+        self.assertEqual(moves[0], (0, False))  # ...but not the travel onto it
+        self.assertEqual(moves[4], (0, True))
+        self.assertTrue(all(on for _, on in moves[1:]))
+
+    def test_loop_restarts_dark_every_frame(self):
+        plan = plan_playback(*self.SQUARE, mode="loop")
+        moves = playback_moves(plan, frames=3)
+        self.assertEqual([on for index, on in moves if index == 0], [False] * 3)
+
+    def test_pingpong_turns_around_lit(self):
+        plan = plan_playback([10.0, 20.0, 30.0, 40.0], [10.0, 12.0, 10.0, 12.0], [False, True, True, True])
+        self.assertEqual(plan.mode, "pingpong")
+        moves = playback_moves(plan, frames=2)
+        self.assertEqual([index for index, _ in moves], [0, 1, 2, 3, 2, 1, 0])
+        self.assertFalse(moves[0][1])
+
+    def test_shapes_enter_dark(self):
+        ring = shape_plan(Shape("ring", "circle", 45.0, 45.0, 10.0, 10.0, points=12))
+        self.assertEqual(ring.mode, "wrap")
+        moves = playback_moves(ring, frames=2)
+        self.assertEqual(moves[0], (0, False))
+        self.assertEqual(moves[12], (0, True))  # the seam closes the circle
+        hook = shape_plan(Shape("hook", "arc", 45.0, 45.0, 10.0, 10.0, points=8))
+        self.assertEqual(hook.mode, "pingpong")
+        self.assertFalse(hook.laser_states[0])
+        self.assertEqual(playback_moves(hook, frames=1)[0], (0, False))
+
+
+def decode_records(words):
+    """The sketch's recordAngle(), laserAt() and levelAt() over a record array"""
+    points = []
+    for xw, yw in zip(words[0::2], words[1::2]):
+        level = (1 if xw & 0x8000 else 0) | ((yw >> 14) << 1)
+        points.append(((xw & 0x3FFF) / 100, (yw & 0x3FFF) / 100, bool(xw & 0x4000), level))
+    return points
+
+
+class RecordEncodingTest(unittest.TestCase):
+    def test_records_round_trip(self):
+        rng = random.Random(2)
+        xs = [round(rng.uniform(0, 163.83), 2) for _ in range(200)]
+        ys = [round(rng.uniform(0, 163.83), 2) for _ in range(200)]
+        laser = [rng.random() < 0.7 for _ in range(200)]
+        levels = [rng.randrange(8) for _ in range(200)]
+        self.assertEqual(decode_records(encode_records(xs, ys, laser, levels)), list(zip(xs, ys, laser, levels)))
+
+    def test_out_of_range_angle_is_rejected(self):
+        with self.assertRaises(ValueError):
+            encode_records([164.0], [10.0], [True], [0])
+
+    def test_bank_round_trip(self):
+        patterns = [
+            Pattern("square", [10.0, 20.0, 20.0, 10.0], [10.0, 10.0, 20.0, 20.0], [True] * 4),
+            Pattern("zigzag", [30.5, 31.25, 32.0, 40.75, 41.0], [50.0, 55.5, 50.0, 55.5, 60.0],
+                    [False, True, True, False, True]),
+        ]
+        code = generate_bank_cpp(patterns, 1.6, 1.5, detail_levels=3)
+        for index, pattern in enumerate(patterns):
+            array = re.search(rf"const uint16_t pattern{index}\[\] PROGMEM = \{{(.*?)\}};", code).group(1)
+            words = [int(word, 16) for word in array.split(", ")]
+            plan = plan_playback(pattern.x_angles, pattern.y_angles, pattern.laser_states)
+            levels = assign_detail_levels(plan.x_angles, plan.y_angles, plan.laser_states, 3)
+            self.assertEqual(
+                decode_records(words),
+                list(zip(plan.x_angles, plan.y_angles, plan.laser_states, levels))
+            )
+            self.assertIn(f"{{pattern{index}, {len(pattern.x_angles)}, PLAYBACK_", code)
+
+    def test_empty_pattern_is_rejected(self):
+        square = Pattern("square", [10.0, 20.0, 20.0], [10.0, 10.0, 20.0], [True] * 3)
+        with self.assertRaises(ValueError):
+            generate_bank_cpp([square, Pattern("empty", [], [], [])], 1.6, 1.5)
+        with self.assertRaises(ValueError):
+            generate_bank_cpp([Pattern("short", [10.0, 20.0], [10.0], [True, True])], 1.6, 1.5)
+
+
+if __name__ == "__main__":
+    unittest.main()
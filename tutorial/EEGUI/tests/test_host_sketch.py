@@ -0,0 +1,245 @@
+"""
+Tests that build generated sketches for the host (see host/build.py) and run them
+Run from tutorial/EEGUI: python -m unittest discover tests
+"""
+
+import math
+import shutil
+import subprocess
+import tempfile
+import unittest
+from pathlib import Path
+
+from cpp_generator import (
+    Cue, Pattern, Shape, _player_steps, generate_bank_cpp, generate_cpp, plan_playback, playback_moves, shape_plan
+)
+from host.build import build
+from show_file import save_show_file
+
+MICROSTEPS = 16
+STEPS_PER_DEGREE = 200 * MICROSTEPS / 360.0
+
+SD_READ_DRIVER = r"""
+int main() {
+  beginShowStream();
+  if (!showFileOpen) return 2;
+  selectPattern(patternCount + 1);
+  // Forwards, then backwards, prefetching between points as the decode side does
+  for (long i = 0; i < numAngles; i++) {
+    prefetchShowBlock();
+    printf("%.2f %.2f %d\n", xAngleAt(i), yAngleAt(i), laserAt(i) ? 1 : 0);
+  }
+  playDirection = -1;
+  for (long i = numAngles - 1; i >= 0; i--) {
+    prefetchShowBlock();
+    printf("%.2f %.2f %d\n", xAngleAt(i), yAngleAt(i), laserAt(i) ? 1 : 0);
+  }
+  printf("reads %ld\n", showBlockReads);
+  return 0;
+}
+"""
+
+SD_PLAY_DRIVER = r"""
+int main() {
+  setup();
+  selectPattern(patternCount + 1);
+  // Moves started by the time each block read was done
+  std::vector<size_t> readAt;
+  for (long n = 0; n < 200000 && stepperY.targets.size() < (size_t)numAngles; n++) {
+    long reads = showBlockReads;
+    loop();
+    for (; reads < showBlockReads; reads++) readAt.push_back(stepperY.targets.size());
+  }
+  printf("%ld\n", movingBlockReads);
+  for (size_t i = 0; i < readAt.size(); i++) printf("%zu ", readAt[i]);
+  printf("\n");
+  for (size_t i = 0; i < stepperY.targets.size(); i++) printf("%ld\n", stepperY.targets[i]);
+  return 0;
+}
+"""
+
+PLAY_DRIVER = r"""
+int main(int, char **argv) {
+  setup();
+  selectPattern(atoi(argv[1]));
+  size_t moves = atol(argv[2]);
+  for (long n = 0; n < 200000 && stepperY.targets.size() < moves; n++) {
+    loop();
+  }
+  for (size_t i = 0; i < moves && i < stepperY.targets.size(); i++) {
+    int laser = (stepperY.pins[i] >> LASER_PIN) & 1;
+    printf("%d %ld %ld\n", laser, stepperY.targets[i], stepperX.targets[i]);
+  }
+  return 0;
+}
+"""
+
+CUE_DRIVER = r"""
+int main(int, char **argv) {
+  setup();  // starts the first cue
+  size_t moves = atol(argv[1]);
+  for (long n = 0; n < 200000 && stepperY.targets.size() < moves; n++) {
+    loop();
+  }
+  for (size_t i = 0; i < moves && i < stepperY.targets.size(); i++) {
+    printf("%ld %ld\n", stepperY.targets[i], stepperX.targets[i]);
+  }
+  return 0;
+}
+"""
+
+QUEUE_DRIVER = r"""
+int main(int, char **argv) {
+  setup();  // starts the motion thread
+  waitForMotionIdle();
+  long count = atol(argv[1]);
+  for (long i = 0; i < count; i++) {
+    queueMove(10 + (i * 37 % 101) * 0.5, 10 + (i * 53 % 97) * 0.5, i % 3 != 0);
+  }
+  waitForMotionIdle();
+  printf("%d %d\n", (int)motionHead, (int)motionTail);
+  for (size_t i = 0; i < stepperY.targets.size(); i++) {
+    printf("%ld %ld\n", stepperY.targets[i], stepperX.targets[i]);
+  }
+  return 0;
+}
+"""
+
+
+def spiral(count: int):
+    xs = [45 + 20 * math.cos(i / 7) * i / count for i in range(count)]
+    ys = [45 + 20 * math.sin(i / 7) * i / count for i in range(count)]
+    laser = [i % 37 != 0 for i in range(count)]
+    return [round(x, 2) for x in xs], [round(y, 2) for y in ys], laser
+
+
+@unittest.skipUnless(shutil.which("g++"), "needs g++")
+class HostSketchTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(tempfile.mkdtemp(prefix="eegui_host_"))
+
+    def tearDown(self):
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def build_and_run(self, code: str, driver: str, defines=(), arguments=()) -> str:
+        sketch = self.directory / "sketch.cpp"
+        sketch.write_text(code)
+        binary = self.directory / "sketch_host"
+        self.assertEqual(build(sketch, binary, driver, defines), "")
+        result = subprocess.run(
+            [str(binary), *arguments], cwd=self.directory, capture_output=True, text=True, timeout=60
+        )
+        self.assertEqual(result.returncode, 0, result.stderr)
+        return result.stdout
+
+    def play(self, code: str, pattern: int, moves: int):
+        """(laser, X steps, Y steps) of the first moves of a pattern on a host AVR build"""
+        out = self.build_and_run(code, PLAY_DRIVER, ["BOARD=BOARD_AVR"], [str(pattern), str(moves)])
+        return [(line.split()[0] == "1", *map(int, line.split()[1:])) for line in out.splitlines()]
+
+    def sd_sketch(self, points: int, playback: str = "loop"):
+        xs, ys, laser = spiral(points)
+        save_show_file(str(self.directory / "SHOW.BIN"), xs, ys, laser, playback)
+        code = generate_bank_cpp(
+            [Pattern("dot", [40.0, 41.0, 41.0], [40.0, 40.0, 41.0], [True] * 3)],
+            1.6, 1.5, microsteps=MICROSTEPS, sd_streaming=True
+        )
+        return code, plan_playback(xs, ys, laser, playback)
+
+    def test_show_streams_across_block_boundaries(self):
+        # 128 records per block: 300 points span blocks 1 to 3
+        code, plan = self.sd_sketch(300)
+        lines = self.build_and_run(code, SD_READ_DRIVER).splitlines()
+        expected = [
+            f"{x:.2f} {y:.2f} {int(on)}"
+            for x, y, on in zip(plan.x_angles, plan.y_angles, plan.laser_states)
+        ]
+        self.assertEqual(lines[:300], expected)
+        self.assertEqual(lines[300:600], expected[::-1])
+        # Header, blocks 1-3, the wrap-around prefetch of block 1, then 2 and 1 backwards
+        self.assertEqual(lines[600], "reads 7")
+
+    def test_single_core_reads_ahead_between_moves(self):
+        code, plan = self.sd_sketch(300)
+        out = self.build_and_run(code, SD_PLAY_DRIVER, ["BOARD=BOARD_AVR"]).splitlines()
+        self.assertEqual(int(out[0]), 0)  # no read with a stepper on its way
+        read_at = [int(v) for v in out[1].split()]
+        self.assertGreaterEqual(len(read_at), 3)
+        # Each block is in before the cursor gets near it (128 records per block)
+        for block, moves in enumerate(read_at[:3]):
+            self.assertLess(moves, block * 128 - 64 if block else 8)
+        # stepperY follows the X angles (the sketch swaps the axes)
+        self.assertEqual([int(v) for v in out[2:302]], _player_steps(plan.x_angles, STEPS_PER_DEGREE))
+
+    def test_motion_thread_plays_the_queue_in_order(self):
+        # Enough moves for the byte head and tail to wrap around 256 twice
+        count = 600
+        code = generate_bank_cpp(
+            [Pattern("dot", [40.0, 41.0, 41.0], [40.0, 40.0, 41.0], [True] * 3)],
+            1.6, 1.5, microsteps=MICROSTEPS
+        )
+        out = self.build_and_run(code, QUEUE_DRIVER, ["BOARD=BOARD_HOST"], [str(count)]).splitlines()
+        head, tail = map(int, out[0].split())
+        self.assertEqual(head, tail)
+        self.assertEqual(head, (count + 1) % 256)  # plus setup()'s laser off
+        xs = [10 + (i * 37 % 101) * 0.5 for i in range(count)]
+        ys = [10 + (i * 53 % 97) * 0.5 for i in range(count)]
+        # stepperY follows the X angles (the sketch swaps the axes)
+        steps = zip(_player_steps(xs, STEPS_PER_DEGREE), _player_steps(ys, STEPS_PER_DEGREE))
+        expected = [f"{x} {y}" for x, y in steps]
+        self.assertEqual(out[1:], expected)
+
+    def test_shapes_enter_dark(self):
+        shapes = [
+            Shape("ring", "circle", 45.0, 45.0, 10.0, 10.0, points=24),
+            Shape("hook", "arc", 45.0, 45.0, 10.0, 10.0, points=16, sweep_deg=270.0),
+        ]
+        code = generate_bank_cpp(shapes, 1.6, 1.5, microsteps=MICROSTEPS)
+        for index, shape in enumerate(shapes):
+            moves = self.play(code, index, 60)
+            # Across the ring's seam and the hook's turnarounds
+            expected = [on for _, on in playback_moves(shape_plan(shape), frames=4)][:60]
+            self.assertEqual([on for on, _, _ in moves], expected, shape.kind)
+            self.assertFalse(expected[0])
+
+    def test_restart_moves_are_dark(self):
+        # Point 0 is lit in both, covering the WRAP seam; LOOP restarts onto it
+        square = ([40.0, 50.0, 50.0, 40.0], [40.0, 40.0, 50.0, 50.0], [True] * 4)
+        for mode in ("loop", "wrap"):
+            code = generate_cpp(*square, 1.6, 1.5, microsteps=MICROSTEPS, playback=mode)
+            plan = plan_playback(*square, mode)
+            self.assertTrue(plan.laser_states[0])
+            lasers = [on for on, _, _ in self.play(code, 0, 12)]
+            self.assertEqual(lasers, [on for _, on in playback_moves(plan, frames=3)], mode)
+            self.assertFalse(lasers[0], mode)
+            self.assertEqual(lasers[4::4], [mode == "wrap"] * 2, mode)
+
+    def test_timeline_passes_over_a_missing_pattern(self):
+        square = Pattern("square", [40.0, 50.0, 50.0, 40.0], [40.0, 40.0, 50.0, 50.0], [True] * 4)
+        triangle = Pattern("triangle", [60.0, 70.0, 65.0], [60.0, 60.0, 68.0], [True] * 3)
+        # Cue 1 plays the EEPROM slot, which is empty
+        timeline = [Cue(0), Cue(2), Cue(1)]
+        code = generate_bank_cpp(
+            [square, triangle], 1.6, 1.5, microsteps=MICROSTEPS, playback="loop", timeline=timeline
+        )
+        out = self.build_and_run(code, CUE_DRIVER, ["BOARD=BOARD_AVR"], ["7"])
+        moves = [tuple(map(int, line.split())) for line in out.splitlines()]
+        expected = [
+            list(zip(_player_steps(p.x_angles, STEPS_PER_DEGREE), _player_steps(p.y_angles, STEPS_PER_DEGREE)))
+            for p in (square, triangle)
+        ]
+        self.assertEqual(moves, expected[0] + expected[1])
+
+    def test_frames_land_on_the_same_steps(self):
+        # 8.89 steps/deg: every angle sits between steps, where a carried
+        # remainder would move the point from one frame to the next
+        xs = [40.3, 52.55, 47.61, 41.12, 60.07]
+        ys = [40.2, 41.77, 55.35, 49.9, 44.44]
+        code = generate_cpp(xs, ys, [True] * 5, 1.6, 1.5, microsteps=MICROSTEPS, playback="loop")
+        moves = self.play(code, 0, 15)
+        frame = list(zip(_player_steps(xs, STEPS_PER_DEGREE), _player_steps(ys, STEPS_PER_DEGREE)))
+        self.assertEqual([(x, y) for _, x, y in moves], frame * 3)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,54 @@
+"""
+Tests for primitive_detect.py
+Run from tutorial/EEGUI: python -m unittest discover tests
+"""
+
+import unittest
+
+import cv2
+import numpy as np
+
+from primitive_detect import find_primitives
+from processor import primitive_path
+
+
+class FindCirclesTest(unittest.TestCase):
+    def test_circle_is_found(self):
+        image = np.zeros((200, 200), np.uint8)
+        cv2.circle(image, (100, 100), 40, 255, 1)
+        primitives, rest = find_primitives(image)
+        self.assertEqual([p.kind for p in primitives], ["circle"])
+        self.assertAlmostEqual(primitives[0].radius, 40, delta=1)
+        self.assertEqual(len(rest), 0)
+
+    def test_rejected_candidate_does_not_end_the_search(self):
+        # The dashed ring has the most inliers but no dash is long enough
+        # for an arc, so it is turned down before the solid ring is tried
+        image = np.zeros((300, 300), np.uint8)
+        for angle in range(0, 360, 9):
+            cv2.ellipse(image, (150, 150), (100, 100), 0, angle, angle + 4, 255, 1)
+        cv2.circle(image, (150, 150), 25, 255, 1)
+        primitives, rest = find_primitives(image)
+        self.assertEqual([p.kind for p in primitives], ["circle"])
+        self.assertAlmostEqual(primitives[0].radius, 25, delta=1)
+        # The dashes are left over for the point-chain fallback
+        self.assertGreater(len(rest), 200)
+
+
+class PrimitivePathTest(unittest.TestCase):
+    def test_primitives_count_against_max_points(self):
+        image = np.zeros((300, 300), np.uint8)
+        for radius in (30, 60, 90):
+            cv2.circle(image, (150, 150), radius, 255, 1)
+        cv2.line(image, (10, 10), (290, 40), 255, 1)
+        # A scribble for the point-chain fallback
+        for x in range(20, 280, 4):
+            image[250 + (x // 4) % 7 * 3, x:x + 4] = 255
+        for max_points in (20, 60, 150):
+            xs, _, _, primitives, _, _ = primitive_path(image, max_points)
+            self.assertGreaterEqual(len(primitives), 4)
+            self.assertLessEqual(len(xs), max_points)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,182 @@
+"""
+Tests for stage_cache.py and the pipeline's use of it
+Run from tutorial/EEGUI: python -m unittest discover tests
+"""
+
+import os
+import shutil
+import tempfile
+import unittest
+from pathlib import Path
+from unittest import mock
+
+import cv2
+import numpy as np
+
+import stage_cache
+from processor import ProcessingConfig, ProcessingSession, process_image
+from stage_cache import StageCache
+
+
+class StageCacheTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(tempfile.mkdtemp(prefix="eegui_cache_"))
+        self.cache = StageCache(self.directory)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def test_key_follows_every_input(self):
+        key = StageCache.key("path", "upstream", 100, True, 0.5)
+        self.assertEqual(key, StageCache.key("path", "upstream", 100, True, 0.5))
+        for other in [
+            StageCache.key("angles", "upstream", 100, True, 0.5),
+            StageCache.key("path", "elsewhere", 100, True, 0.5),
+            StageCache.key("path", "upstream", 101, True, 0.5),
+            StageCache.key("path", "upstream", 100, False, 0.5),
+            StageCache.key("path", "upstream", 100, True, 0.25),
+        ]:
+            self.assertNotEqual(key, other)
+        with mock.patch.object(stage_cache, "CACHE_VERSION", stage_cache.CACHE_VERSION + 1):
+            self.assertNotEqual(key, StageCache.key("path", "upstream", 100, True, 0.5))
+
+    def test_file_key_follows_content_not_name(self):
+        first, second = self.directory / "a.bin", self.directory / "b.bin"
+        first.write_bytes(b"laser")
+        second.write_bytes(b"laser")
+        self.assertEqual(StageCache.file_key(str(first)), StageCache.file_key(str(second)))
+        second.write_bytes(b"lasers")
+        self.assertNotEqual(StageCache.file_key(str(first)), StageCache.file_key(str(second)))
+
+    def test_computes_once_then_reads_back(self):
+        calls = []
+
+        def compute():
+            calls.append(1)
+            return {"points": [1.5, 2.5]}
+
+        key = StageCache.key("stage", 1)
+        self.assertEqual(self.cache.get(key, compute), {"points": [1.5, 2.5]})
+        self.assertEqual(self.cache.get(key, compute), {"points": [1.5, 2.5]})
+        self.assertEqual(StageCache(self.directory).get(key, compute), {"points": [1.5, 2.5]})
+        self.assertEqual(len(calls), 1)
+        self.assertEqual((self.cache.hits, self.cache.misses), (1, 1))
+
+    def test_damaged_entry_is_recomputed(self):
+        key = StageCache.key("stage", 2)
+        self.cache.get(key, lambda: 1)
+        self.cache._path(key).write_bytes(b"\x80\x05truncated")
+        self.assertEqual(self.cache.get(key, lambda: 2), 2)
+        self.assertEqual(StageCache(self.directory).get(key, lambda: 3), 2)
+
+    def test_entry_that_fails_to_load_is_replaced(self):
+        key = StageCache.key("stage", 3)
+        self.cache.get(key, lambda: 1)
+        # Pickled by code that has gone since
+        self.cache._path(key).write_bytes(b"cvanished_module\nStage\n.")
+        self.assertEqual(self.cache.get(key, lambda: 2), 2)
+        self.assertEqual(StageCache(self.directory).get(key, lambda: 3), 2)
+
+    def test_prune_keeps_the_recently_used(self):
+        keys = [StageCache.key("stage", n) for n in range(4)]
+        for age, key in enumerate(keys):
+            self.cache.get(key, lambda: bytes(1000))
+            os.utime(self.cache._path(key), (age, age))
+        self.cache.get(keys[0], lambda: None)  # read, so used last
+        size = self.cache._path(keys[0]).stat().st_size
+        StageCache(self.directory, max_bytes=2 * size).prune()
+        self.assertEqual([self.cache._path(key).exists() for key in keys], [True, False, False, True])
+
+        self.cache.clear()
+        self.assertEqual(list(self.directory.glob("*/*.pkl")), [])
+
+
+class PipelineCacheTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(tempfile.mkdtemp(prefix="eegui_cache_"))
+        self.image = str(self.directory / "drawing.png")
+        image = np.full((200, 200, 3), 255, np.uint8)
+        cv2.circle(image, (100, 100), 60, (0, 0, 0), 3)
+        cv2.line(image, (20, 180), (180, 150), (0, 0, 0), 3)
+        cv2.imwrite(self.image, image)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def run_stages(self, config: ProcessingConfig):
+        """(hits, misses) of one fresh run through the cache"""
+        cache = StageCache(self.directory / "cache")
+        result = process_image(self.image, config, cache)
+        self.assertTrue(result.success, result.message)
+        return cache.hits, cache.misses
+
+    def test_changes_miss_only_the_stages_they_feed(self):
+        config = ProcessingConfig(max_points=80)
+        # gray, skeleton, path and angles all run
+        self.assertEqual(self.run_stages(config), (0, 4))
+        # path and angles read back, nothing upstream is touched
+        self.assertEqual(self.run_stages(config), (2, 0))
+        # A path parameter reruns the path from the cached skeleton
+        self.assertEqual(self.run_stages(ProcessingConfig(max_points=90)), (1, 2))
+        # A skeleton parameter reruns the skeleton from the cached gray image
+        self.assertEqual(self.run_stages(ProcessingConfig(max_points=80, skeleton_method="zhang_suen")), (1, 3))
+        # Geometry only reaches the angles
+        self.assertEqual(self.run_stages(ProcessingConfig(max_points=80, wall_distance_meters=2.0)), (1, 1))
+
+    def test_same_image_under_another_name_hits(self):
+        self.run_stages(ProcessingConfig())
+        copy = self.directory / "copy.png"
+        shutil.copy(self.image, copy)
+        cache = StageCache(self.directory / "cache")
+        process_image(str(copy), ProcessingConfig(), cache)
+        self.assertEqual((cache.hits, cache.misses), (2, 0))
+
+    def test_edited_image_misses(self):
+        self.run_stages(ProcessingConfig())
+        image = cv2.imread(self.image)
+        cv2.circle(image, (40, 40), 15, (0, 0, 0), 3)
+        cv2.imwrite(self.image, image)
+        self.assertEqual(self.run_stages(ProcessingConfig()), (0, 4))
+
+    def test_session_reruns_only_the_angles_for_geometry(self):
+        session = ProcessingSession()
+        session.process(self.image, ProcessingConfig())
+        self.assertEqual(session.rerun, ["path", "angles"])
+        session.process(self.image, ProcessingConfig(wall_distance_meters=2.5))
+        self.assertEqual(session.rerun, ["angles"])
+        session.process(self.image, ProcessingConfig(wall_distance_meters=2.5))
+        self.assertEqual(session.rerun, [])
+        session.process(self.image, ProcessingConfig(wall_distance_meters=2.5, max_points=60))
+        self.assertEqual(session.rerun, ["path", "angles"])
+
+    def test_simplification_stays_out_of_the_path_stage(self):
+        # The wall tolerance scales with the projected size, so it is applied to the angles
+        session = ProcessingSession()
+        plain = session.process(self.image, ProcessingConfig(max_points=200))
+        for size in (4.0, 2.0, 1.0):
+            simplified = session.process(
+                self.image, ProcessingConfig(max_points=200, projected_size_meters=size, simplify_tolerance_mm=20.0)
+            )
+            self.assertEqual(session.rerun, ["angles"])
+            self.assertTrue(simplified.success, simplified.message)
+            self.assertLess(simplified.point_count, plain.point_count)
+            self.assertGreaterEqual(simplified.resample_error, plain.resample_error)
+            self.assertFalse(simplified.laser_states[0])
+        # Bigger on the wall, the same millimetres are fewer pixels: more points stay
+        bigger = session.process(
+            self.image, ProcessingConfig(max_points=200, projected_size_meters=8.0, simplify_tolerance_mm=20.0)
+        )
+        self.assertGreater(bigger.point_count, simplified.point_count)
+
+    def test_simplification_follows_the_aspect_correction(self):
+        session = ProcessingSession()
+        config = dict(max_points=200, simplify_tolerance_mm=20.0)
+        plain = session.process(self.image, ProcessingConfig(**config))
+        # Taller on the wall, the same curves bend further from their chords
+        stretched = session.process(self.image, ProcessingConfig(aspect_ratio_correction=3.0, **config))
+        self.assertEqual(session.rerun, ["angles"])
+        self.assertGreater(stretched.point_count, plain.point_count)
+
+
+if __name__ == "__main__":
+    unittest.main()
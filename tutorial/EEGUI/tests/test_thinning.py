@@ -0,0 +1,97 @@
+"""
+Tests for thinning.py
+Run from tutorial/EEGUI: python -m unittest discover tests
+"""
+
+import unittest
+from unittest import mock
+
+import cv2
+import numpy as np
+
+from thinning import NEIGHBOURHOOD, TABLES, THINNING_METHODS, thin
+
+
+def code(*neighbours: int) -> int:
+    """Neighbourhood code with the given P2..P9 set"""
+    return sum(1 << (p - 2) for p in neighbours)
+
+
+def table_thin(image: np.ndarray, method: str) -> np.ndarray:
+    """thin() through its own tables even where cv2.ximgproc is installed"""
+    with mock.patch.object(cv2, "ximgproc", None, create=True):
+        return thin(image, method)
+
+
+class ThinningTablesTest(unittest.TestCase):
+    def test_neighbours_run_clockwise_from_north(self):
+        self.assertEqual(NEIGHBOURHOOD[0], (-1, 0))  # P2
+        self.assertEqual(NEIGHBOURHOOD[2], (0, 1))   # P4
+        self.assertEqual(NEIGHBOURHOOD[6], (0, -1))  # P8
+
+    def test_zhang_suen_peels_south_east_first(self):
+        table = TABLES["zhang_suen"]
+        south_edge = code(2, 3, 4, 8, 9)  # ink above, nothing below
+        self.assertTrue(table[0, south_edge])
+        self.assertFalse(table[1, south_edge])
+        north_edge = code(4, 5, 6, 7, 8)  # ink below, nothing above
+        self.assertFalse(table[0, north_edge])
+        self.assertTrue(table[1, north_edge])
+
+    def test_end_points_bridges_and_interior_stay(self):
+        for method in THINNING_METHODS:
+            for step in (0, 1):
+                table = TABLES[method][step]
+                self.assertFalse(table[0], method)  # isolated pixel
+                self.assertFalse(table[code(4)], method)  # end of a line
+                self.assertFalse(table[code(2, 6)], method)  # joins two parts
+                self.assertFalse(table[code(4, 8)], method)
+                self.assertFalse(table[255], method)  # inside a blob
+
+    def test_guo_hall_corner_rule(self):
+        # A north-east corner (ink south and west) is left to the second pass
+        table = TABLES["guo_hall"]
+        corner = code(6, 7, 8)
+        self.assertFalse(table[0, corner])
+        self.assertTrue(table[1, corner])
+        # A south-east one goes in either
+        self.assertTrue(table[0, code(2, 8, 9)])
+        self.assertTrue(table[1, code(2, 8, 9)])
+
+
+class ThinTest(unittest.TestCase):
+    def test_one_pixel_lines_are_unchanged(self):
+        image = np.zeros((40, 40), np.uint8)
+        cv2.line(image, (5, 5), (34, 5), 255, 1)
+        cv2.line(image, (5, 10), (30, 34), 255, 1)
+        for method in THINNING_METHODS:
+            np.testing.assert_array_equal(table_thin(image, method), image, method)
+
+    def test_bar_thins_to_a_connected_line(self):
+        image = np.zeros((30, 80), np.uint8)
+        image[10:19, 10:70] = 255
+        for method in THINNING_METHODS:
+            thinned = table_thin(image, method)
+            columns = (thinned[:, 15:65] > 0).sum(axis=0)
+            self.assertTrue((columns == 1).all(), method)
+            self.assertEqual(cv2.connectedComponents(thinned, connectivity=8)[0], 2, method)
+            rows = np.flatnonzero(thinned[:, 40])
+            self.assertTrue(10 <= rows[0] <= 18, method)
+
+    def test_ring_keeps_its_hole(self):
+        image = np.zeros((60, 60), np.uint8)
+        cv2.circle(image, (30, 30), 20, 255, 5)
+        for method in THINNING_METHODS:
+            thinned = table_thin(image, method)
+            # One ring of ink around one hole, plus the background outside
+            self.assertEqual(cv2.connectedComponents(thinned, connectivity=8)[0], 2, method)
+            self.assertEqual(cv2.connectedComponents(255 - thinned, connectivity=4)[0], 3, method)
+            self.assertEqual(thinned[30, 30], 0, method)
+
+    def test_unknown_method_is_rejected(self):
+        with self.assertRaises(ValueError):
+            thin(np.zeros((4, 4), np.uint8), "medial_axis")
+
+
+if __name__ == "__main__":
+    unittest.main()